@@ -0,0 +1,41 @@
+#include <chrono>
+#include <thread>
+#include <iostream>
+#include <coutils.hpp>
+
+using namespace std::chrono;
+using namespace std::chrono_literals;
+
+coutils::thread_pool pool(8);
+
+// computes synchronously when started, like a CPU-bound async_fn
+coutils::async_fn<int> work(int i) {
+    std::this_thread::sleep_for(50ms);
+    co_return i;
+}
+
+template <typename F>
+coutils::async_fn<void> timed(const char* name, F f) {
+    auto start = steady_clock::now();
+    auto&& [a, b, c, d, e, f_, g, h] = co_await f();
+    auto ms = duration_cast<milliseconds>(steady_clock::now() - start).count();
+    std::cout << name << ": sum " << a + b + c + d + e + f_ + g + h << " in " << ms << "ms" << std::endl;
+}
+
+coutils::async_fn<void> test() {
+    co_await coutils::resume_on(pool);
+    // children are started one after another on this thread
+    co_await timed("all_completed", [] {
+        return coutils::all_completed(work(1), work(2), work(3), work(4), work(5), work(6), work(7), work(8));
+    });
+    // children are started on different workers of the pool
+    co_await timed("all_completed_on", [] {
+        return coutils::all_completed_on(pool, work(1), work(2), work(3), work(4), work(5), work(6), work(7), work(8));
+    });
+    auto&& nothing = co_await coutils::all_completed_on(pool);
+    std::cout << "without awaitables: " << std::tuple_size_v<std::remove_cvref_t<decltype(nothing)>> << " results" << std::endl;
+}
+
+int main() {
+    coutils::wait(test());
+}
@@ -0,0 +1,36 @@
+#include <string>
+#include <chrono>
+#include <iostream>
+#include <coutils.hpp>
+
+using namespace std::chrono_literals;
+
+coutils::thread_pool pool(4);
+coutils::async_cache<int, std::string> users(1024, 1min);
+
+// pretends to be a slow query
+coutils::async_fn<std::string> fetch_user(int id) {
+    std::cout << "fetching user " + std::to_string(id) + "\n";
+    std::this_thread::sleep_for(10ms);
+    co_return "user#" + std::to_string(id);
+}
+
+coutils::async_fn<void> handle_request(int id) {
+    auto name = co_await users.get(id, fetch_user);
+    std::cout << "request for " + std::to_string(id) + " got " + name + "\n";
+}
+
+coutils::async_fn<void> serve() {
+    // the requests for the same user share one fetch
+    co_await coutils::all_completed_on(pool,
+        handle_request(1), handle_request(1), handle_request(2), handle_request(1));
+    // now it is cached
+    co_await handle_request(2);
+}
+
+int main() {
+    coutils::wait(serve());
+    auto stats = users.stats();
+    std::cout << "hits: " << stats.hits << ", misses: " << stats.misses
+              << ", coalesced: " << stats.coalesced << std::endl;
+}
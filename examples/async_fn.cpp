@@ -1,4 +1,5 @@
 #include <iostream>
+#include <optional>
 #include <coutils.hpp>
 
 struct compound { int a, b, c; };
@@ -14,11 +15,9 @@ coutils::async_fn<compound> make_compound() {
     co_return coutils::co_result(1, 2, 3);
 }
 
-#if 0
 coutils::async_fn<heavy> make_heavy() {
     co_return coutils::co_result(1, 2, 3);
 }
-#endif
 
 coutils::async_fn<void> test() {
     {
@@ -28,15 +27,21 @@ coutils::async_fn<void> test() {
             << val.a << ' ' << val.b << ' ' << val.c
         << std::endl;
     }
-#if 0
     {
-        // non-recontructible values are not supported
+        // non-recontructible values are kept in the callee
         auto val = co_await make_heavy();
         std::cout << "Result of make_heavy: "
             << val->a << ' ' << val->b << ' ' << val->c
         << std::endl;
     }
-#endif
+    {
+        // or constructed directly in storage of the caller
+        std::optional<heavy> val;
+        co_await make_heavy().into(val);
+        std::cout << "Result of make_heavy into slot: "
+            << val->a << ' ' << val->b << ' ' << val->c
+        << std::endl;
+    }
 }
 
 int main() {
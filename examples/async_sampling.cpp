@@ -0,0 +1,42 @@
+#define COUTILS_ASYNC_SAMPLING
+#include <cmath>
+#include <iostream>
+#include <coutils.hpp>
+
+coutils::async_fn<double> leaf(int n) {
+    double x = 0;
+    for (int i = 1; i <= n; ++i) { x += std::sqrt(double(i)); }
+    co_return x;
+}
+
+coutils::async_fn<double> middle(int n) {
+    double x = 0;
+    // many short-lived frames, finished ones must not be sampled
+    for (int i = 0; i < 100; ++i) { x += co_await leaf(n); }
+    co_return x;
+}
+
+coutils::async_fn<void> show_backtrace() {
+    for (auto&& loc : co_await coutils::async_backtrace())
+        { std::cout << "  " << loc.function_name() << ':' << loc.line() << std::endl; }
+}
+
+coutils::async_fn<double> outer() {
+    std::cout << "async_backtrace():" << std::endl;
+    co_await show_backtrace();
+    double x = 0;
+    for (int i = 0; i < 200; ++i) { x += co_await middle(i * 50); }
+    co_return x;
+}
+
+int main() {
+    coutils::async_sampler sampler;
+    sampler.start(997);
+    auto result = coutils::wait(outer());
+    // outside any async_fn once `outer` is freed, samples here are dropped
+    for (int i = 1; i <= 50000000; ++i) { result -= std::sqrt(double(i)); }
+    sampler.stop();
+    std::cout << "result: " << result << std::endl;
+    std::cout << sampler.size() << " samples kept, " << sampler.dropped() << " dropped, folded stacks:" << std::endl;
+    sampler.dump_folded(std::cout);
+}
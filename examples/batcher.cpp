@@ -0,0 +1,35 @@
+#include <string>
+#include <vector>
+#include <iostream>
+#include <coutils.hpp>
+
+// one thread, so that all renders run in the same tick
+coutils::thread_pool pool(1);
+
+// pretends to be a backend answering many keys in one round trip
+coutils::async_fn<std::vector<std::string>> fetch_names(std::span<const int> ids) {
+    std::string line = "one query for";
+    for (auto id : ids) { line += ' ' + std::to_string(id); }
+    std::cout << line + "\n";
+    std::vector<std::string> names;
+    for (auto id : ids) { names.push_back("user#" + std::to_string(id)); }
+    co_return names;
+}
+
+coutils::batcher<int, std::string> names(fetch_names, pool, 8);
+
+coutils::async_fn<void> render(int id) {
+    // each coroutine asks for its own key, and keys asked in the same tick
+    // share a query
+    auto name = co_await names.load(id);
+    std::cout << "rendered " + name + "\n";
+}
+
+coutils::async_fn<void> render_all() {
+    co_await coutils::resume_on(pool);
+    co_await coutils::all_completed(render(1), render(2), render(3), render(4));
+}
+
+int main() {
+    coutils::wait(render_all());
+}
@@ -0,0 +1,106 @@
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+#include <coutils.hpp>
+
+using namespace std::chrono_literals;
+using uint = unsigned int;
+
+coutils::thread_pool pool(2);
+
+auto iota(uint n) -> coutils::async_generator<uint> {
+    for (uint i = 0; i < n; ++i) { co_yield i; }
+}
+
+auto ticks(uint n) -> coutils::async_generator<uint> {
+    for (uint i = 0; i < n; ++i) {
+        co_await coutils::sleep_for(5ms, pool);
+        co_yield i;
+    }
+}
+
+auto faulty(uint n) -> coutils::async_generator<uint> {
+    for (uint i = 0; i < n; ++i) { co_yield i; }
+    throw std::runtime_error("source failed");
+}
+
+// sums what a subscriber reads, sleeping after each item
+coutils::async_fn<uint> sum(auto sub, std::chrono::milliseconds delay) {
+    uint total = 0;
+    auto it = sub.begin();
+    while (true) {
+        co_await it;
+        if (it == sub.end()) { break; }
+        total += *it;
+        if (delay != 0ms) { co_await coutils::sleep_for(delay, pool); }
+    }
+    std::cout << "  read " << total << ", dropped " << sub.dropped() << std::endl;
+    co_return total;
+}
+
+coutils::async_fn<void> test() {
+    co_await coutils::resume_on(pool);
+
+    std::cout << "throttle, a fast and a slow subscriber:" << std::endl;
+    {
+        coutils::broadcast b(iota(20), 4);
+        co_await coutils::all_completed(sum(b.subscribe(), 0ms), sum(b.subscribe(), 1ms));
+    }
+
+    std::cout << "drop_oldest, a fast and a slow subscriber:" << std::endl;
+    {
+        coutils::broadcast b(iota(20), 4, coutils::broadcast_policy::drop_oldest);
+        co_await coutils::all_completed(sum(b.subscribe(), 0ms), sum(b.subscribe(), 1ms));
+    }
+
+    // the last item resumes this coroutine from the pump, which is still
+    // running when the broadcast is destroyed
+    std::cout << "read to the end, then destroy:" << std::endl;
+    {
+        coutils::broadcast b(ticks(5), 2);
+        auto sub = b.subscribe();
+        auto it = sub.begin();
+        while (true) {
+            co_await it;
+            if (it == sub.end()) { break; }
+            std::cout << "  " << *it;
+        }
+        std::cout << std::endl;
+    }
+
+    // the pump is still waiting for the next tick when the broadcast goes
+    std::cout << "destroy after 3 items:" << std::endl;
+    {
+        coutils::broadcast b(ticks(100), 2);
+        auto sub = b.subscribe();
+        auto it = sub.begin();
+        for (uint i = 0; i < 3; ++i) {
+            co_await it;
+            std::cout << "  " << *it;
+        }
+        std::cout << std::endl;
+    }
+
+    std::cout << "a throwing source:" << std::endl;
+    {
+        coutils::broadcast b(faulty(3), 2);
+        auto sub = b.subscribe();
+        auto it = sub.begin();
+        try {
+            while (true) {
+                co_await it;
+                if (it == sub.end()) { break; }
+                std::cout << "  " << *it;
+            }
+        } catch (const std::exception& e) {
+            std::cout << std::endl << "  caught: " << e.what() << std::endl;
+        }
+    }
+
+    // give the pump left behind by early destroy time to finish
+    co_await coutils::sleep_for(20ms, pool);
+}
+
+int main() {
+    coutils::wait(test());
+}
@@ -0,0 +1,39 @@
+#include <chrono>
+#include <string>
+#include <iostream>
+#include <unordered_map>
+#include <coutils.hpp>
+
+using namespace std::chrono;
+using namespace std::chrono_literals;
+
+coutils::thread_pool pool(2);
+std::unordered_map<int, std::string> cache;
+
+// a hit finishes before the caller awaits it, a miss suspends on the pool
+coutils::eager_async_fn<std::string> lookup(int key) {
+    if (auto it = cache.find(key); it != cache.end()) { co_return it->second; }
+    co_await coutils::sleep_for(10ms, pool);
+    auto value = "value " + std::to_string(key);
+    cache.emplace(key, value);
+    co_return value;
+}
+
+coutils::async_fn<void> test() {
+    co_await coutils::resume_on(pool);
+
+    auto start = steady_clock::now();
+    std::cout << "miss: " << co_await lookup(1);
+    std::cout << " in " << duration_cast<milliseconds>(steady_clock::now() - start).count() << "ms" << std::endl;
+    std::cout << "hit: " << co_await lookup(1) << std::endl;
+
+    // a hit has already finished when awaited, so the caller never suspends
+    auto hit = lookup(1), miss = lookup(2);
+    std::cout << std::boolalpha << "hit finished before awaited: " << hit.await_ready() << std::endl;
+    std::cout << "miss finished before awaited: " << miss.await_ready() << std::endl;
+    std::cout << co_await std::move(hit) << ", " << co_await std::move(miss) << std::endl;
+}
+
+int main() {
+    coutils::wait(test());
+}
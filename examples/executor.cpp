@@ -0,0 +1,23 @@
+#include <thread>
+#include <iostream>
+#include <coutils.hpp>
+
+coutils::thread_pool io_pool(1), cpu_pool(1);
+
+coutils::async_fn<int> read_value() {
+    co_await io_pool.schedule();
+    std::cout << "reading on io pool: " << io_pool.running_in_this_thread() << std::endl;
+    co_return 42;
+}
+
+coutils::async_fn<void> test() {
+    co_await cpu_pool.schedule();
+    auto value = co_await read_value();
+    // the caller is posted back to its own pool after `read_value` finishes
+    std::cout << "got " << value << " on cpu pool: "
+        << cpu_pool.running_in_this_thread() << std::endl;
+}
+
+int main() {
+    coutils::wait(test());
+}
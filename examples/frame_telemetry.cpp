@@ -0,0 +1,34 @@
+#define COUTILS_FRAME_TELEMETRY
+#include <iostream>
+#include <coutils.hpp>
+
+coutils::thread_pool pool(2);
+
+coutils::async_fn<int> small(int n) { co_return n + 1; }
+
+// shares the report of `small`, but shows up in another size bucket
+coutils::async_fn<int> large(int n) {
+    int buf[64] = {};
+    for (int i = 0; i < 64; ++i) { buf[i] = co_await small(i); }
+    co_return buf[n % 64];
+}
+
+auto iota(int n) -> coutils::async_generator<int> {
+    for (int i = 0; i < n; ++i) { co_yield i; }
+}
+
+coutils::async_fn<int> test() {
+    int sum = 0;
+    for (int i = 0; i < 10; ++i) { sum += co_await large(i); }
+    COUTILS_FOR(int i, iota(100))
+        sum += i;
+    COUTILS_ENDFOR()
+    // frames allocated here are freed on a pool thread
+    co_await coutils::resume_on(pool);
+    co_return sum;
+}
+
+int main() {
+    std::cout << "result: " << coutils::wait(test()) << std::endl;
+    coutils::print_frame_telemetry(std::cout);
+}
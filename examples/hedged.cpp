@@ -0,0 +1,42 @@
+#include <string>
+#include <chrono>
+#include <random>
+#include <iostream>
+#include <coutils.hpp>
+
+using namespace std::chrono;
+using namespace std::chrono_literals;
+
+coutils::thread_pool pool(4);
+coutils::hedge_stats stats;
+
+// a replica that is usually fast but sometimes stalls
+coutils::async_fn<std::string> query(std::stop_token stop) {
+    thread_local std::mt19937 rng(std::random_device{}());
+    auto latency = std::uniform_int_distribution(0, 9)(rng) == 0 ? 200ms : 5ms;
+    co_await coutils::sleep_for(latency);
+    if (stop.stop_requested()) { co_return "(discarded)"; }
+    co_return "answer";
+}
+
+coutils::async_fn<void> client() {
+    co_await coutils::resume_on(pool);
+    auto start = steady_clock::now();
+    milliseconds worst{0};
+    for (int i = 0; i < 50; ++i) {
+        auto begin = steady_clock::now();
+        // a second attempt is sent if the first takes longer than 20ms
+        co_await coutils::hedged(query, 20ms, 2, &stats);
+        worst = std::max(worst, duration_cast<milliseconds>(steady_clock::now() - begin));
+    }
+    std::cout << "50 queries in " << duration_cast<milliseconds>(steady_clock::now() - start).count()
+              << "ms, the slowest took " << worst.count() << "ms" << std::endl;
+}
+
+int main() {
+    coutils::wait(client());
+    std::cout << "calls: " << stats.calls << ", hedges: " << stats.hedges
+              << ", won by hedges: " << stats.hedge_wins << std::endl;
+    // lets discarded attempts finish before timers are destroyed
+    std::this_thread::sleep_for(250ms);
+}
@@ -0,0 +1,82 @@
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <iostream>
+#include <shared_mutex>
+#include <coutils.hpp>
+
+constexpr std::size_t total_ops = 1 << 20;
+// every cell stops after this long, as FIFO locks crawl on few cores
+constexpr auto time_box = std::chrono::milliseconds(300);
+
+struct cell {
+    double ns_per_op;
+    std::size_t ops;
+};
+
+// runs `op` `total_ops / threads` times per thread, or until the time box
+// ends, `op` gets the index and a thread local accumulator
+template <typename Op>
+cell run_cell(std::size_t threads, Op op) {
+    std::atomic<std::size_t> done = 0, sink = 0;
+    auto start = std::chrono::steady_clock::now();
+    auto deadline = start + time_box;
+    std::vector<std::thread> workers;
+    for (std::size_t t = 0; t < threads; ++t) {
+        workers.emplace_back([&] {
+            std::size_t i = 0, acc = 0;
+            while (i < total_ops / threads) {
+                op(i++, acc);
+                if (i % 256 == 0 && std::chrono::steady_clock::now() > deadline) { break; }
+            }
+            done.fetch_add(i);
+            sink.fetch_add(acc);
+        });
+    }
+    for (auto&& w : workers) { w.join(); }
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    return {elapsed.count() / double(done.load()), done.load()};
+}
+
+template <typename Lock>
+double bench_exclusive(std::size_t threads) {
+    Lock lock;
+    std::size_t counter = 0;
+    auto result = run_cell(threads, [&](std::size_t, std::size_t&)
+        { auto guard = std::lock_guard(lock); ++counter; });
+    if (counter != result.ops) { std::cerr << "broken lock!" << std::endl; }
+    return result.ns_per_op;
+}
+
+// one of 16 operations writes, others read
+template <typename Lock>
+double bench_shared(std::size_t threads) {
+    Lock lock;
+    std::size_t counter = 0;
+    return run_cell(threads, [&](std::size_t i, std::size_t& seen) {
+        if (i % 16 == 0) { auto guard = std::lock_guard(lock); ++counter; }
+        else { auto guard = std::shared_lock(lock); seen += counter; }
+    }).ns_per_op;
+}
+
+int main() {
+    std::size_t max_threads = std::max(4u, 2 * std::thread::hardware_concurrency());
+    std::cout << "ns per exclusive lock:\nthreads\tlight\tadaptive\tticket\tmcs\trw\tstd::mutex\n";
+    for (std::size_t n = 1; n <= max_threads; n *= 2) {
+        std::cout << n
+            << '\t' << bench_exclusive<coutils::light_lock>(n)
+            << '\t' << bench_exclusive<coutils::adaptive_lock>(n)
+            << '\t' << bench_exclusive<coutils::ticket_lock>(n)
+            << '\t' << bench_exclusive<coutils::mcs_lock>(n)
+            << '\t' << bench_exclusive<coutils::rw_lock>(n)
+            << '\t' << bench_exclusive<std::mutex>(n) << std::endl;
+    }
+    std::cout << "ns per operation, 1/16 writes:\nthreads\trw\tstd::shared_mutex\n";
+    for (std::size_t n = 1; n <= max_threads; n *= 2) {
+        std::cout << n
+            << '\t' << bench_shared<coutils::rw_lock>(n)
+            << '\t' << bench_shared<std::shared_mutex>(n) << std::endl;
+    }
+}
@@ -0,0 +1,47 @@
+#include <iostream>
+#include <coutils.hpp>
+
+using uint = unsigned int;
+
+coutils::async_fn<uint> square(uint n) { co_return n * n; }
+
+auto iota(uint from, uint n) -> coutils::async_generator<uint> {
+    for (uint i = from; i < from + n; ++i) { co_yield i; }
+}
+
+coutils::async_fn<void> test() {
+    std::cout << "coutils::merge:" << std::endl;
+    auto merged = coutils::merge(iota(0, 3), iota(100, 3));
+    auto m = merged.begin();
+    while (true) {
+        co_await m;
+        if (m == merged.end()) { break; }
+        std::cout << *m << "(from " << m.index() << ") ";
+    }
+    std::cout << std::endl;
+
+    std::cout << "coutils::zip:" << std::endl;
+    auto zipped = coutils::zip(iota(0, 3), iota(100, 5));
+    auto z = zipped.begin();
+    while (true) {
+        co_await z;
+        if (z == zipped.end()) { break; }
+        auto&& [a, b] = *z;
+        std::cout << "(" << a << ", " << b << ") ";
+    }
+    std::cout << std::endl;
+
+    std::cout << "coutils::map_concurrent:" << std::endl;
+    auto mapped = coutils::map_concurrent(iota(0, 10), square, 4);
+    auto s = mapped.begin();
+    while (true) {
+        co_await s;
+        if (s == mapped.end()) { break; }
+        std::cout << *s << ' ';
+    }
+    std::cout << std::endl;
+}
+
+int main() {
+    coutils::wait(test());
+}
@@ -0,0 +1,54 @@
+#include <chrono>
+#include <random>
+#include <ranges>
+#include <vector>
+#include <numeric>
+#include <iostream>
+#include <algorithm>
+#include <coutils.hpp>
+
+template <typename F>
+double millis(F&& f) {
+    auto start = std::chrono::steady_clock::now();
+    f();
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+int main() {
+    constexpr std::size_t n = 1 << 22;
+    std::vector<std::uint64_t> data(n), out(n);
+    std::mt19937_64 rng(42);
+    for (auto&& x : data) { x = rng() % 1000000; }
+    std::cout << "workers: " << coutils::parallel_pool().size() << ", elements: " << n << std::endl;
+
+    std::uint64_t serial_sum = 0, parallel_sum = 0;
+    auto serial = millis([&] { serial_sum = std::reduce(data.begin(), data.end(), std::uint64_t(0)); });
+    auto parallel = millis([&] {
+        parallel_sum = coutils::wait(coutils::parallel_reduce(data.begin(), data.end(), std::uint64_t(0)));
+    });
+    std::cout << "reduce: serial " << serial << "ms, parallel " << parallel << "ms, "
+        << (serial_sum == parallel_sum ? "same" : "DIFFERENT") << std::endl;
+
+    serial = millis([&] { std::inclusive_scan(data.begin(), data.end(), out.begin()); });
+    auto expected = out;
+    parallel = millis([&] { coutils::wait(coutils::parallel_scan(data.begin(), data.end(), out.begin())); });
+    std::cout << "scan: serial " << serial << "ms, parallel " << parallel << "ms, "
+        << (out == expected ? "same" : "DIFFERENT") << std::endl;
+
+    serial = millis([&] { std::transform(data.begin(), data.end(), out.begin(), [](auto x) { return x * x % 7919; }); });
+    expected = out;
+    parallel = millis([&] {
+        auto indices = std::views::iota(std::size_t(0), n);
+        coutils::wait(coutils::parallel_for(indices.begin(), indices.end(),
+            [&](std::size_t i) { out[i] = data[i] * data[i] % 7919; }));
+    });
+    std::cout << "for: serial " << serial << "ms, parallel " << parallel << "ms, "
+        << (out == expected ? "same" : "DIFFERENT") << std::endl;
+
+    expected = data;
+    serial = millis([&] { std::stable_sort(expected.begin(), expected.end()); });
+    parallel = millis([&] { coutils::wait(coutils::parallel_sort(data.begin(), data.end())); });
+    std::cout << "sort: serial " << serial << "ms, parallel " << parallel << "ms, "
+        << (data == expected ? "same" : "DIFFERENT") << std::endl;
+}
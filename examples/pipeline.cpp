@@ -0,0 +1,35 @@
+#include <string>
+#include <vector>
+#include <optional>
+#include <iostream>
+#include <coutils.hpp>
+
+coutils::thread_pool pool(4);
+
+int main() {
+    std::vector<std::string> lines = {"3", "1", "4", "1", "5", "9", "2", "6", "5", "3"};
+    std::size_t next = 0;
+    long total = 0;
+
+    auto pipe = coutils::pipeline(
+        // read: called one at a time, in order
+        [&]() -> coutils::async_fn<std::optional<std::string>> {
+            if (next == lines.size()) { co_return std::nullopt; }
+            co_return lines[next++];
+        },
+        // parse and transform: any number at a time
+        coutils::stage<coutils::stage_mode::parallel>(
+            [](std::string line) -> coutils::async_fn<long> { co_return std::stol(line); }),
+        coutils::stage<coutils::stage_mode::parallel>(
+            [](long x) -> coutils::async_fn<long> { co_return x * x; }),
+        // write: one at a time, in the order of reading
+        coutils::stage<coutils::stage_mode::serial_in_order>(
+            [&](long x) -> coutils::async_fn<void> {
+                total += x;
+                std::cout << x << ' ';
+                co_return;
+            })
+    );
+    coutils::wait(pipe.run(pool, 4));
+    std::cout << "\ntotal: " << total << std::endl;
+}
@@ -0,0 +1,44 @@
+#include <chrono>
+#include <atomic>
+#include <iostream>
+#include <coutils.hpp>
+
+using namespace std::chrono_literals;
+using clock_type = std::chrono::steady_clock;
+
+coutils::priority_scheduler sched(1);
+
+void busy_for(clock_type::duration d) {
+    auto until = clock_type::now() + d;
+    while (clock_type::now() < until) {}
+}
+
+coutils::async_fn<void> step() {
+    // requeued with the priority of the caller
+    co_await sched.schedule();
+    busy_for(100us);
+}
+
+coutils::async_fn<void> request(int priority, std::atomic<long long>& total_us) {
+    auto queued = clock_type::now();
+    co_await sched.schedule(priority);
+    busy_for(1ms);
+    co_await step();
+    auto latency = clock_type::now() - queued;
+    total_us += std::chrono::duration_cast<std::chrono::microseconds>(latency).count();
+}
+
+coutils::async_fn<void> test() {
+    constexpr int batch = 100, urgent = 10;
+    std::atomic<long long> batch_us = 0, urgent_us = 0;
+    coutils::task_group group(batch + urgent);
+    for (int i = 0; i < batch; ++i) { co_await group.spawn(request(0, batch_us)); }
+    for (int i = 0; i < urgent; ++i) { co_await group.spawn(request(7, urgent_us)); }
+    co_await group.join();
+    std::cout << "mean latency of batch requests: " << batch_us / batch << "us" << std::endl;
+    std::cout << "mean latency of urgent requests: " << urgent_us / urgent << "us" << std::endl;
+}
+
+int main() {
+    coutils::wait(test());
+}
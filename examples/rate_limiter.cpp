@@ -0,0 +1,44 @@
+#include <string>
+#include <chrono>
+#include <iostream>
+#include <coutils.hpp>
+
+using namespace std::chrono;
+
+coutils::thread_pool pool(2);
+// 20 requests per second to each host, at most 5 at once, and 30 per second
+// to all hosts together
+coutils::keyed_rate_limiter<std::string> limits(20, 5, 30, 5);
+
+coutils::async_fn<void> crawl(std::string host, int pages) {
+    co_await coutils::resume_on(pool);
+    auto start = steady_clock::now();
+    for (int i = 0; i < pages; ++i) {
+        co_await limits.acquire(host);
+        // the request to `host` would be sent here
+    }
+    auto took = duration_cast<milliseconds>(steady_clock::now() - start).count();
+    std::cout << host + ": " + std::to_string(pages) + " pages in " + std::to_string(took) + "ms\n";
+}
+
+int main() {
+    coutils::wait(coutils::all_completed(crawl("a.example", 15), crawl("b.example", 15)));
+
+    // a leaky bucket driven by a clock of our own
+    coutils::rate_limiter spaced(10, 1, nullptr);
+    auto t = steady_clock::now();
+    spaced.pump(t);
+    int sent = 0;
+    auto sender = [&]() -> coutils::async_fn<void> {
+        for (int i = 0; i < 3; ++i) { co_await spaced.acquire(); ++sent; }
+    };
+    auto task = sender();
+    coutils::wait(coutils::all_completed(std::move(task), [&]() -> coutils::async_fn<void> {
+        for (int tick = 1; tick <= 3; ++tick) {
+            std::cout << "at " << tick * 100 << "ms: " << sent << " sent" << std::endl;
+            spaced.pump(t + milliseconds(tick * 100));
+        }
+        co_return;
+    }()));
+    std::cout << "finally: " << sent << " sent" << std::endl;
+}
@@ -0,0 +1,25 @@
+#include <vector>
+#include <iostream>
+#include <coutils.hpp>
+
+// each shard owns one counter, only touched on its own thread
+coutils::sharded_executor shards(4, 256, 64, false);
+std::vector<unsigned long> counters(shards.size());
+
+coutils::async_fn<unsigned long> add_on_shard(unsigned long n) {
+    auto id = shards.current_shard();
+    counters[id] += n;
+    co_return counters[id];
+}
+
+coutils::async_fn<void> test() {
+    for (unsigned long i = 0; i < 1000; ++i) {
+        auto shard = i % shards.size();
+        auto total = co_await coutils::submit_to(shards[shard], add_on_shard(i));
+        if (i >= 996) { std::cout << "shard " << shard << " total: " << total << std::endl; }
+    }
+}
+
+int main() {
+    coutils::wait(test());
+}
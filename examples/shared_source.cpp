@@ -0,0 +1,46 @@
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <array>
+#include <coutils.hpp>
+
+using uint = unsigned int;
+
+auto iota(uint n) -> coutils::async_generator<uint> {
+    for (uint i = 0; i < n; ++i) { co_yield i; }
+}
+
+using source_t = coutils::shared_source<coutils::async_generator<uint>>;
+
+coutils::async_fn<uint> sum_one_by_one(source_t& src) {
+    uint sum = 0;
+    while (auto v = co_await src.next()) { sum += *v; }
+    co_return sum;
+}
+
+coutils::async_fn<uint> sum_in_batches(source_t& src) {
+    uint sum = 0;
+    std::array<uint, 8> buf;
+    while (auto n = co_await src.next_batch(buf)) {
+        for (std::size_t i = 0; i < n; ++i) { sum += buf[i]; }
+    }
+    co_return sum;
+}
+
+int main() {
+    source_t src(iota(1000));
+    std::vector<uint> sums(4);
+    std::vector<std::thread> workers;
+    for (std::size_t i = 0; i < sums.size(); ++i) {
+        workers.emplace_back([&, i] {
+            sums[i] = coutils::wait(i % 2 ? sum_in_batches(src) : sum_one_by_one(src));
+        });
+    }
+    uint total = 0;
+    for (std::size_t i = 0; i < sums.size(); ++i) {
+        workers[i].join();
+        std::cout << "worker " << i << ": " << sums[i] << std::endl;
+        total += sums[i];
+    }
+    std::cout << "total: " << total << std::endl;
+}
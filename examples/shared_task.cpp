@@ -0,0 +1,23 @@
+#include <string>
+#include <iostream>
+#include <coutils.hpp>
+
+coutils::shared_task<std::string> load_config() {
+    std::cout << "loading config" << std::endl;
+    co_return "answer=42";
+}
+
+coutils::async_fn<void> reader(unsigned id, coutils::shared_task<std::string> config) {
+    // only the first reader runs `load_config`, all of them get the same string
+    const std::string& value = co_await config;
+    std::cout << "reader " << id << " got " << value << std::endl;
+}
+
+coutils::async_fn<void> test() {
+    auto config = load_config();
+    for (unsigned i = 0; i < 3; ++i) { co_await reader(i, config); }
+}
+
+int main() {
+    coutils::wait(test());
+}
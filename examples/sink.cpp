@@ -0,0 +1,62 @@
+#include <string>
+#include <iostream>
+#include <string_view>
+#include <coutils.hpp>
+
+// Splits text arriving in chunks of any size into lines, only copying the
+// part of a line that spans more than one chunk.
+auto line_splitter(std::size_t& longest) -> coutils::sink<std::string_view, std::size_t> {
+    std::size_t lines = 0;
+    std::string partial;
+    while (auto chunk = co_await coutils::next_input) {
+        auto rest = *chunk;
+        for (auto pos = rest.find('\n'); pos != rest.npos; pos = rest.find('\n')) {
+            std::string_view line = rest.substr(0, pos);
+            if (!partial.empty()) { partial.append(line); line = partial; }
+            std::cout << "line " << ++lines << ": " << line << std::endl;
+            longest = std::max(longest, line.size());
+            partial.clear();
+            rest.remove_prefix(pos + 1);
+        }
+        partial.append(rest);
+    }
+    if (!partial.empty()) {
+        std::cout << "line " << ++lines << ": " << partial << std::endl;
+        longest = std::max(longest, partial.size());
+    }
+    co_return lines;
+}
+
+// A state machine taking one character at a time.
+auto digit_counter() -> coutils::sink<char, unsigned> {
+    unsigned digits = 0;
+    while (auto c = co_await coutils::next_input) {
+        if (*c == '.') { co_return digits; }
+        if (*c < '0' || *c > '9') { throw std::runtime_error("not a digit"); }
+        ++digits;
+    }
+    co_return digits;
+}
+
+int main() {
+    std::string_view text = "first line\nsecond\n\nthe last line has no newline";
+    std::size_t longest = 0;
+    auto splitter = line_splitter(longest);
+    for (std::size_t i = 0; i < text.size(); i += 7)
+        { splitter.push(text.substr(i, 7)); }
+    auto lines = splitter.close();
+    std::cout << lines << " lines, the longest has " << longest << " characters" << std::endl;
+
+    std::string_view number = "12345.678";
+    auto counter = digit_counter();
+    auto taken = counter.push_span(std::span(number));
+    std::cout << "took " << taken << " characters, " << counter.close() << " digits" << std::endl;
+
+    try {
+        auto bad = digit_counter();
+        bad.push('1');
+        bad.push('x'); // throws an exception
+    } catch (const std::exception& exc) {
+        std::cerr << "Caught exception: " << exc.what() << std::endl;
+    }
+}
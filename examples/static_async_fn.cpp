@@ -0,0 +1,44 @@
+#include <thread>
+#include <optional>
+#include <iostream>
+#include <coutils.hpp>
+
+// terminates if a frame ever outgrows its block, so 256 bytes is verified
+// for this target every time the example runs
+template <typename T>
+using small_fn = coutils::static_async_fn<T, 256, coutils::crt::frame_overflow::terminate>;
+
+small_fn<int> square(int n) { co_return n * n; }
+
+small_fn<int> sum_of_squares(int n) {
+    int sum = 0;
+    for (int i = 1; i <= n; ++i) { sum += co_await square(i); }
+    co_return sum;
+}
+
+// the frame goes into `buf`, so this never touches the pool
+small_fn<int> cube(coutils::crt::frame_buffer<256>& buf, int n) {
+    (void)buf;
+    co_return n * n * n;
+}
+
+// a call created on the main thread but destroyed after its pool is gone
+std::optional<small_fn<int>> late;
+
+int main() {
+    // after the first call warms up the pool, frames are recycled
+    std::cout << "sum of squares: " << coutils::wait(sum_of_squares(10)) << std::endl;
+    std::cout << "sum of squares: " << coutils::wait(sum_of_squares(20)) << std::endl;
+
+    coutils::crt::frame_buffer<256> buf;
+    for (int i = 1; i <= 3; ++i) {
+        std::cout << "cube of " << i << ": " << coutils::wait(cube(buf, i)) << std::endl;
+    }
+
+    // frames created on a thread which exits, then freed on this one
+    std::optional<small_fn<int>> orphan;
+    std::thread([&] { orphan.emplace(square(7)); }).join();
+    std::cout << "square of 7 from another thread: " << coutils::wait(std::move(*orphan)) << std::endl;
+
+    late.emplace(square(8));
+}
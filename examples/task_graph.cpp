@@ -0,0 +1,34 @@
+#include <string>
+#include <iostream>
+#include <coutils.hpp>
+
+coutils::thread_pool pool(4);
+
+int main() {
+    coutils::task_graph build;
+    auto step = [](std::string name) {
+        return [name]() -> coutils::async_fn<void> {
+            std::cout << name + "\n";
+            co_return;
+        };
+    };
+
+    // a small build: compiling `big.cpp` is the long pole, so it starts first
+    auto fetch = build.add(step("fetch sources"));
+    auto small_a = build.add(step("compile a.cpp"));
+    auto small_b = build.add(step("compile b.cpp"));
+    auto big = build.add(step("compile big.cpp"), 10);
+    auto link = build.add(step("link"), 2);
+    auto docs = build.add(step("build docs"));
+    for (auto obj : {small_a, small_b, big}) {
+        build.precede(fetch, obj);
+        build.precede(obj, link);
+    }
+    build.precede(fetch, docs);
+
+    std::cout << "critical path: " << build.critical_path(fetch) << std::endl;
+    coutils::wait(build.run(pool, 2));
+    // the same graph runs again without being rebuilt
+    std::cout << "again" << std::endl;
+    coutils::wait(build.run(pool, 2));
+}
@@ -0,0 +1,29 @@
+#include <iostream>
+#include <coutils.hpp>
+
+coutils::async_fn<void> work(unsigned id) {
+    std::cout << "child " << id << " running" << std::endl;
+    if (id == 5) { throw std::runtime_error("child 5 failed"); }
+    co_return;
+}
+
+coutils::async_fn<void> test() {
+    coutils::task_group group(2);
+    for (unsigned i = 0; i < 8; ++i) {
+        // children spawned after the failure are dropped
+        bool started = co_await group.spawn(work(i));
+        if (!started) { std::cout << "child " << i << " dropped" << std::endl; }
+    }
+    try {
+        co_await group.join();
+    } catch (const coutils::aggregate_error& exc) {
+        for (auto&& err : exc.errors()) {
+            try { std::rethrow_exception(err); }
+            catch (const std::exception& e) { std::cerr << "Caught exception: " << e.what() << std::endl; }
+        }
+    }
+}
+
+int main() {
+    coutils::wait(test());
+}
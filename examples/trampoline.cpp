@@ -0,0 +1,31 @@
+#include <cstdint>
+#include <iostream>
+#include <coutils.hpp>
+
+std::uintptr_t deepest = 0, shallowest = UINTPTR_MAX;
+
+// completes without suspending, so all_completed resumes its caller inline
+coutils::async_fn<int> ready(int n) {
+    int marker = n;
+    auto at = reinterpret_cast<std::uintptr_t>(&marker);
+    if (at > deepest) { deepest = at; }
+    if (at < shallowest) { shallowest = at; }
+    co_return marker;
+}
+
+coutils::async_fn<long> test(int rounds) {
+    long sum = 0;
+    for (int i = 0; i < rounds; ++i) {
+        auto&& [a, b] = co_await coutils::all_completed(ready(i), ready(1));
+        sum += a + b;
+    }
+    co_return sum;
+}
+
+int main() {
+    // without the trampoline each round nests the next one on the stack
+    constexpr int rounds = 300000;
+    std::cout << "sum: " << coutils::wait(test(rounds)) << std::endl;
+    std::cout << "stack growth over " << rounds << " rounds: "
+              << deepest - shallowest << " bytes" << std::endl;
+}
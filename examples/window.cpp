@@ -0,0 +1,114 @@
+#include <string>
+#include <chrono>
+#include <limits>
+#include <iostream>
+#include <algorithm>
+#include <coutils.hpp>
+
+using namespace std::chrono;
+using namespace std::chrono_literals;
+
+coutils::thread_pool pool(2);
+
+struct reading {
+    std::string sensor;
+    double value;
+};
+
+// count, mean, min and max of readings, all mergeable in O(1)
+struct stats_aggregate {
+    struct state {
+        std::size_t n = 0;
+        double sum = 0;
+        double min = std::numeric_limits<double>::infinity();
+        double max = -std::numeric_limits<double>::infinity();
+    };
+
+    state init() const { return {}; }
+    void add(state& s, const reading& r) const {
+        ++s.n; s.sum += r.value;
+        s.min = std::min(s.min, r.value); s.max = std::max(s.max, r.value);
+    }
+    void merge(state& s, const state& o) const {
+        s.n += o.n; s.sum += o.sum;
+        s.min = std::min(s.min, o.min); s.max = std::max(s.max, o.max);
+    }
+    state result(const state& s) const { return s; }
+};
+
+// a bursty stream of readings, stalling in between
+auto readings() -> coutils::async_generator<reading> {
+    const char* sensors[] = {"a", "b", "c"};
+    for (int burst = 0; burst < 3; ++burst) {
+        for (int i = 0; i < 7; ++i) {
+            reading r{sensors[i % 3], double(burst * 10 + i)};
+            co_yield std::move(r);
+        }
+        co_await coutils::sleep_for(60ms, pool);
+    }
+}
+
+auto numbers(int n) -> coutils::async_generator<int> {
+    for (int i = 1; i <= n; ++i) { co_yield i; }
+}
+
+void print(const stats_aggregate::state& s) {
+    std::cout << "n=" << s.n << " mean=" << s.sum / double(s.n)
+              << " min=" << s.min << " max=" << s.max << '\n';
+}
+
+coutils::async_fn<void> test() {
+    co_await coutils::resume_on(pool);
+
+    std::cout << "sums of 4 numbers, then of the last 4 every 2:\n";
+    auto tumbling = coutils::tumbling_window(numbers(10), 4, coutils::fold_aggregate{0, std::plus<>{}});
+    auto t = tumbling.begin();
+    while (true) {
+        co_await t;
+        if (t == tumbling.end()) { break; }
+        std::cout << t->value << ' ';
+    }
+    std::cout << '\n';
+    auto sliding = coutils::sliding_window(numbers(10), 4, 2, coutils::fold_aggregate{0, std::plus<>{}});
+    auto s = sliding.begin();
+    while (true) {
+        co_await s;
+        if (s == sliding.end()) { break; }
+        std::cout << s->value << ' ';
+    }
+    std::cout << '\n';
+
+    // windows of 5 readings, flushed when the stream stalls for 20ms
+    std::cout << "windows of 5 readings:\n";
+    auto counted = coutils::tumbling_window(readings(), 5, stats_aggregate{}, 20ms);
+    auto c = counted.begin();
+    while (true) {
+        co_await c;
+        if (c == counted.end()) { break; }
+        print(c->value);
+    }
+
+    // each reading falls in 3 windows of 120ms, ending every 40ms
+    std::cout << "readings of the last 120ms every 40ms:\n";
+    auto timed = coutils::sliding_window(readings(), 120ms, 40ms, stats_aggregate{});
+    auto w = timed.begin();
+    while (true) {
+        co_await w;
+        if (w == timed.end()) { break; }
+        print(w->value);
+    }
+
+    std::cout << "readings per sensor every 50ms:\n";
+    auto grouped = coutils::group_by_key(readings(), &reading::sensor, 50ms, stats_aggregate{});
+    auto g = grouped.begin();
+    while (true) {
+        co_await g;
+        if (g == grouped.end()) { break; }
+        std::cout << g->first << ": ";
+        print(g->second.value);
+    }
+}
+
+int main() {
+    coutils::wait(test());
+}
@@ -4,19 +4,54 @@
 
 #include "coutils/crt/task.hpp"
 #include "coutils/crt/async_fn.hpp"
+#include "coutils/crt/static_async_fn.hpp"
+#include "coutils/crt/eager_async_fn.hpp"
 #include "coutils/crt/generator.hpp"
 #include "coutils/crt/async_generator.hpp"
+#include "coutils/crt/shared_task.hpp"
+#include "coutils/crt/sink.hpp"
 
+#include "coutils/locks.hpp"
+#include "coutils/executor.hpp"
+#include "coutils/thread_pool.hpp"
+#include "coutils/priority_scheduler.hpp"
+#include "coutils/sharded_executor.hpp"
 #include "coutils/async_for.hpp"
 #include "coutils/wait.hpp"
 #include "coutils/multi_await.hpp"
+#include "coutils/multi_stream.hpp"
+#include "coutils/shared_source.hpp"
+#include "coutils/broadcast.hpp"
+#include "coutils/task_group.hpp"
+#include "coutils/parallel.hpp"
+#include "coutils/pipeline.hpp"
+#include "coutils/task_graph.hpp"
+#include "coutils/async_cache.hpp"
+#include "coutils/timer.hpp"
+#include "coutils/batcher.hpp"
+#include "coutils/rate_limiter.hpp"
+#include "coutils/hedged.hpp"
+#include "coutils/window.hpp"
+#include "coutils/backtrace.hpp"
 
 namespace coutils {
 
 using crt::task;
 using crt::async_fn;
+using crt::static_async_fn;
+using crt::eager_async_fn;
+using crt::frame_buffer;
+using crt::frame_overflow;
 using crt::generator;
 using crt::async_generator;
+using crt::shared_task;
+using crt::sink;
+using crt::next_input;
+
+#ifdef COUTILS_FRAME_TELEMETRY
+using crt::frame_telemetry;
+using crt::print_frame_telemetry;
+#endif
 
 } // namespace coutils
 
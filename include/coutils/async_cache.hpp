@@ -0,0 +1,249 @@
+#pragma once
+#ifndef __COUTILS_ASYNC_CACHE__
+#define __COUTILS_ASYNC_CACHE__
+
+#include <bit>
+#include <list>
+#include <mutex>
+#include <chrono>
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <utility>
+#include <algorithm>
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include <type_traits>
+#include <unordered_map>
+#include "coutils/utility.hpp"
+#include "coutils/crt/shared_task.hpp"
+
+namespace coutils {
+
+/**
+ * @brief Counters of an `async_cache`, summed over its shards.
+ */
+struct async_cache_stats {
+    // gets finding a loaded value
+    std::uint64_t hits = 0;
+    // gets starting a load
+    std::uint64_t misses = 0;
+    // gets joining a load started by another get
+    std::uint64_t coalesced = 0;
+    // entries dropped to keep the size bound
+    std::uint64_t evictions = 0;
+};
+
+/**
+ * @brief A concurrent cache of values loaded by coroutines, where concurrent
+ *        misses of a key share one load.
+ *
+ * `co_await cache.get(key, loader)` results in a copy of the value of `key`.
+ * On a miss, `loader(key)` (or `loader()`) is called in a `crt::shared_task`
+ * stored in the cache, and should give an awaitable resulting in the value,
+ * like `async_fn<V>`. Gets of the same key before the load finishes await the
+ * same task, and are all resumed on the thread finishing it. When the load
+ * throws, the exception is rethrown to all of them, and the key is dropped so
+ * that the next get loads it again.
+ *
+ * Keys are spread over `shards` shards by hash, each with its own lock, map
+ * and LRU list, and each keeping at most its part of `capacity` entries.
+ * Entries being loaded count towards the bound too. With a nonzero `ttl`, a
+ * value expires `ttl` after its load finishes, and the next get loads it
+ * again.
+ *
+ * The cache must outlive loads it starts. Every miss allocates a list node, a
+ * map node and the frame of the shared task; a hit allocates nothing.
+ */
+template <typename K, typename V, typename Hash = std::hash<K>, typename Eq = std::equal_to<K>>
+class async_cache {
+public:
+    using clock = std::chrono::steady_clock;
+    using key_type = K;
+    using value_type = V;
+
+private:
+    struct entry {
+        K key;
+        crt::shared_task<V> task;
+        // identifies the load of `task`, since a key may be loaded again
+        std::uint64_t ticket;
+        // `time_point::max()` until loaded
+        clock::time_point expires = clock::time_point::max();
+    };
+
+    using _List = std::list<entry>;
+
+    struct alignas(64) shard {
+        default_lock lock;
+        // most recently used first
+        _List lru;
+        std::unordered_map<K, typename _List::iterator, Hash, Eq> index;
+        std::uint64_t tickets = 0;
+        async_cache_stats stats;
+    };
+
+    std::size_t per_shard;
+    clock::duration ttl;
+    int shift;
+    std::unique_ptr<shard[]> shards;
+    std::size_t count;
+    Hash hash;
+
+    shard& shard_of(const K& key) const {
+        if (count == 1) { return shards[0]; }
+        // Fibonacci hashing, so that weak hashes (like identity for integers)
+        // still spread over shards
+        auto h = std::uint64_t(hash(key)) * 0x9e3779b97f4a7c15ull;
+        return shards[h >> shift];
+    }
+
+    // called with `sh.lock` held
+    void erase_ticket(shard& sh, const K& key, std::uint64_t ticket) {
+        auto found = sh.index.find(key);
+        if (found == sh.index.end() || found->second->ticket != ticket) { return; }
+        sh.lru.erase(found->second);
+        sh.index.erase(found);
+    }
+
+    void loaded(shard& sh, const K& key, std::uint64_t ticket) {
+        auto guard = std::lock_guard(sh.lock);
+        auto found = sh.index.find(key);
+        if (found == sh.index.end() || found->second->ticket != ticket) { return; }
+        found->second->expires = ttl == clock::duration::zero()
+            ? clock::time_point::max() : clock::now() + ttl;
+    }
+
+    void failed(shard& sh, const K& key, std::uint64_t ticket) {
+        auto guard = std::lock_guard(sh.lock);
+        erase_ticket(sh, key, ticket);
+    }
+
+    template <typename L>
+    static decltype(auto) call_loader(L& loader, const K& key) {
+        if constexpr (std::is_invocable_v<L&, const K&>) { return std::invoke(loader, key); }
+        else { return std::invoke(loader); }
+    }
+
+    template <typename L>
+    static crt::shared_task<V> load(async_cache& self, shard& sh, K key, std::uint64_t ticket, L loader) {
+        try {
+            V value(co_await call_loader(loader, key));
+            self.loaded(sh, key, ticket);
+            co_return value;
+        } catch (...) {
+            self.failed(sh, key, ticket);
+            throw;
+        }
+    }
+
+public:
+    explicit async_cache(std::size_t capacity, clock::duration ttl = clock::duration::zero(), std::size_t shards = 16):
+        ttl(ttl) {
+        count = std::bit_ceil(std::clamp<std::size_t>(shards, 1, std::max<std::size_t>(capacity, 1)));
+        shift = 64 - std::countr_zero(count);
+        per_shard = std::max<std::size_t>((capacity + count - 1) / count, 1);
+        this->shards = std::make_unique<shard[]>(count);
+    }
+
+    async_cache(const async_cache&) = delete;
+    async_cache& operator=(const async_cache&) = delete;
+
+    class get_awaiter {
+        crt::shared_task<V> task;
+        typename crt::shared_task<V>::awaiter inner;
+
+    public:
+        get_awaiter(crt::shared_task<V>&& task):
+            task(std::move(task)), inner(this->task.operator co_await()) {}
+        get_awaiter(get_awaiter&&) = default;
+
+        bool await_ready() const noexcept { return inner.await_ready(); }
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<> h)
+            { return inner.await_suspend(h); }
+        V await_resume() const { return V(inner.await_resume()); }
+    };
+
+    /**
+     * @brief Gets the value of `key`, loading it with `loader` on a miss.
+     */
+    template <typename L>
+    get_awaiter get(const K& key, L&& loader) {
+        auto& sh = shard_of(key);
+        auto guard = std::lock_guard(sh.lock);
+        auto found = sh.index.find(key);
+        if (found != sh.index.end()) {
+            auto it = found->second;
+            if (it->task.ready() && it->expires <= clock::now()) {
+                sh.lru.erase(it);
+                sh.index.erase(found);
+            } else {
+                sh.lru.splice(sh.lru.begin(), sh.lru, it);
+                ++(it->task.ready() ? sh.stats.hits : sh.stats.coalesced);
+                return get_awaiter(crt::shared_task<V>(it->task));
+            }
+        }
+        ++sh.stats.misses;
+        auto ticket = sh.tickets++;
+        sh.lru.push_front(entry{
+            key, load(*this, sh, key, ticket, std::decay_t<L>(COUTILS_FWD(loader))), ticket
+        });
+        sh.index.emplace(key, sh.lru.begin());
+        while (sh.lru.size() > per_shard) {
+            sh.index.erase(sh.lru.back().key);
+            sh.lru.pop_back();
+            ++sh.stats.evictions;
+        }
+        return get_awaiter(crt::shared_task<V>(sh.lru.front().task));
+    }
+
+    /**
+     * @brief Drops `key`, gets whether it was cached.
+     *
+     * Gets already awaiting its load are not affected.
+     */
+    bool erase(const K& key) {
+        auto& sh = shard_of(key);
+        auto guard = std::lock_guard(sh.lock);
+        auto found = sh.index.find(key);
+        if (found == sh.index.end()) { return false; }
+        sh.lru.erase(found->second);
+        sh.index.erase(found);
+        return true;
+    }
+
+    void clear() {
+        for (std::size_t i = 0; i < count; ++i) {
+            auto guard = std::lock_guard(shards[i].lock);
+            shards[i].index.clear();
+            shards[i].lru.clear();
+        }
+    }
+
+    std::size_t size() const {
+        std::size_t n = 0;
+        for (std::size_t i = 0; i < count; ++i) {
+            auto guard = std::lock_guard(shards[i].lock);
+            n += shards[i].lru.size();
+        }
+        return n;
+    }
+
+    async_cache_stats stats() const {
+        async_cache_stats sum;
+        for (std::size_t i = 0; i < count; ++i) {
+            auto guard = std::lock_guard(shards[i].lock);
+            auto& s = shards[i].stats;
+            sum.hits += s.hits;
+            sum.misses += s.misses;
+            sum.coalesced += s.coalesced;
+            sum.evictions += s.evictions;
+        }
+        return sum;
+    }
+};
+
+} // namespace coutils
+
+#endif // __COUTILS_ASYNC_CACHE__
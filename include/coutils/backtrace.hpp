@@ -0,0 +1,193 @@
+#pragma once
+#ifndef __COUTILS_BACKTRACE__
+#define __COUTILS_BACKTRACE__
+
+#include <vector>
+#include <concepts>
+#include <coroutine>
+#include <source_location>
+#include "coutils/crt/async_fn.hpp"
+
+#ifdef COUTILS_ASYNC_SAMPLING
+#include <map>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <ostream>
+#include <cstdint>
+#include <stdexcept>
+#include <signal.h>
+#include <sys/time.h>
+#endif
+
+namespace coutils {
+
+/**
+ * @brief Collects locations of `frame` and the `async_fn`s awaiting it,
+ *        innermost first.
+ */
+inline std::vector<std::source_location> async_backtrace(const crt::async_frame& frame) {
+    std::vector<std::source_location> stack;
+    for (auto f = &frame; f; f = f->parent) { stack.push_back(f->location); }
+    return stack;
+}
+
+namespace _ {
+
+class async_backtrace_awaiter {
+    std::vector<std::source_location> stack;
+
+public:
+    constexpr bool await_ready() const noexcept { return false; }
+    template <typename P>
+    bool await_suspend(std::coroutine_handle<P> h) {
+        if constexpr (requires { { h.promise().frame } -> std::same_as<crt::async_frame&>; })
+            { stack = async_backtrace(h.promise().frame); }
+        return false;
+    }
+    std::vector<std::source_location> await_resume() noexcept
+        { return std::move(stack); }
+};
+
+} // namespace _
+
+/**
+ * @brief Gets the logical call stack of the awaiting `async_fn`.
+ *
+ * `co_await async_backtrace()` gives locations of the awaiting coroutine and
+ * the chain of `async_fn`s awaiting it, innermost first. The chain ends at the
+ * first caller that is not an `async_fn`. Awaiting this never suspends.
+ */
+inline _::async_backtrace_awaiter async_backtrace() { return {}; }
+
+#ifdef COUTILS_ASYNC_SAMPLING
+
+/**
+ * @brief A `SIGPROF` based sampling profiler of logical `async_fn` stacks.
+ *
+ * Only available when `COUTILS_ASYNC_SAMPLING` is defined, which makes every
+ * `async_fn` track the one running on each thread. While started, the process
+ * is interrupted `hz` times per second of CPU time, and the stack of the
+ * `async_fn` running on the interrupted thread is written to a preallocated
+ * buffer of `capacity` samples, claimed lock-free from the signal handler.
+ * Samples outside any `async_fn`, or after the buffer is full, are counted
+ * but not kept.
+ *
+ * Only one sampler can be started at a time. `dump_folded` writes kept
+ * samples as folded stacks (`outer;inner count` per line) that flame graph
+ * tools take directly.
+ */
+class async_sampler {
+public:
+    static constexpr std::size_t max_depth = 32;
+
+private:
+    using enum std::memory_order;
+
+    struct sample {
+        std::atomic<bool> ready = false;
+        std::uint32_t depth = 0;
+        // function names of frames, innermost first
+        const char* frames[max_depth];
+    };
+
+    std::size_t capacity;
+    std::unique_ptr<sample[]> samples;
+    std::atomic<std::size_t> claimed = 0;
+    std::atomic<std::size_t> missed = 0;
+    struct sigaction previous = {};
+    bool running = false;
+
+    static std::atomic<async_sampler*>& active() {
+        static std::atomic<async_sampler*> instance = nullptr;
+        return instance;
+    }
+
+    static void on_signal(int) {
+        auto self = active().load(acquire);
+        auto frame = crt::_::current_frame;
+        if (!self) { return; }
+        if (!frame) { self->missed.fetch_add(1, relaxed); return; }
+        auto i = self->claimed.fetch_add(1, relaxed);
+        if (i >= self->capacity) { self->missed.fetch_add(1, relaxed); return; }
+        auto& s = self->samples[i];
+        std::uint32_t depth = 0;
+        for (; frame && depth < max_depth; frame = frame->parent)
+            { s.frames[depth++] = frame->location.function_name(); }
+        s.depth = depth;
+        s.ready.store(true, release);
+    }
+
+public:
+    explicit async_sampler(std::size_t capacity = 1 << 16):
+        capacity(capacity), samples(std::make_unique<sample[]>(capacity)) {}
+    ~async_sampler() { stop(); }
+
+    async_sampler(const async_sampler&) = delete;
+    async_sampler& operator=(const async_sampler&) = delete;
+
+    /**
+     * @brief Starts sampling `hz` times per second of process CPU time.
+     */
+    void start(unsigned hz = 99) {
+        if (running) { return; }
+        async_sampler* expected = nullptr;
+        if (!active().compare_exchange_strong(expected, this, acq_rel))
+            { throw std::logic_error("another async_sampler is running"); }
+        struct sigaction action = {};
+        action.sa_handler = &on_signal;
+        action.sa_flags = SA_RESTART;
+        sigemptyset(&action.sa_mask);
+        sigaction(SIGPROF, &action, &previous);
+        auto usec = static_cast<long>(1000000 / (hz ? hz : 1));
+        itimerval timer = {{0, usec}, {0, usec}};
+        setitimer(ITIMER_PROF, &timer, nullptr);
+        running = true;
+    }
+
+    void stop() {
+        if (!running) { return; }
+        itimerval timer = {};
+        setitimer(ITIMER_PROF, &timer, nullptr);
+        sigaction(SIGPROF, &previous, nullptr);
+        active().store(nullptr, release);
+        running = false;
+    }
+
+    /**
+     * @brief Number of samples kept.
+     */
+    std::size_t size() const noexcept
+        { return std::min(claimed.load(acquire), capacity); }
+
+    /**
+     * @brief Number of samples not kept.
+     */
+    std::size_t dropped() const noexcept { return missed.load(acquire); }
+
+    /**
+     * @brief Writes kept samples as folded stacks, should be called after
+     *        `stop()`.
+     */
+    void dump_folded(std::ostream& out) const {
+        std::map<std::string, std::size_t> counts;
+        for (std::size_t i = 0, n = size(); i < n; ++i) {
+            auto& s = samples[i];
+            if (!s.ready.load(acquire)) { continue; }
+            std::string line;
+            for (auto d = s.depth; d-- > 0; ) {
+                line += s.frames[d];
+                if (d) { line += ';'; }
+            }
+            ++counts[std::move(line)];
+        }
+        for (auto&& [stack, count] : counts) { out << stack << ' ' << count << '\n'; }
+    }
+};
+
+#endif // COUTILS_ASYNC_SAMPLING
+
+} // namespace coutils
+
+#endif // __COUTILS_BACKTRACE__
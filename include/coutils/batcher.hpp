@@ -0,0 +1,168 @@
+#pragma once
+#ifndef __COUTILS_BATCHER__
+#define __COUTILS_BATCHER__
+
+#include <span>
+#include <mutex>
+#include <vector>
+#include <chrono>
+#include <cstdint>
+#include <utility>
+#include <optional>
+#include <coroutine>
+#include <exception>
+#include <stdexcept>
+#include <functional>
+#include "coutils/utility.hpp"
+#include "coutils/executor.hpp"
+#include "coutils/timer.hpp"
+#include "coutils/crt/agent.hpp"
+#include "coutils/crt/async_fn.hpp"
+
+namespace coutils {
+
+/**
+ * @brief Collects keys loaded by many coroutines into batches for one call of
+ *        a batch function.
+ *
+ * `co_await b.load(key)` adds `key` to the current batch and results in its
+ * value. The batch function is called with the keys of a batch and should
+ * give an `async_fn` resulting in their values in the same order. A batch is
+ * dispatched when it has `max_batch` keys, or otherwise after one tick of
+ * `ex` (the first key posts a flush to `ex`, which runs after coroutines
+ * already queued there) when `max_delay` is zero, or `max_delay` after its
+ * first key, in which case `ex` may be null. Waiters are resumed on `ex`, or
+ * on the thread finishing the batch when `ex` is null. When the batch function
+ * throws, or gives a wrong number of values, the exception is rethrown to
+ * every waiter of the batch.
+ *
+ * Keys are not deduplicated, wrap the loader with `async_cache` for that.
+ *
+ * Waiters are linked through their awaiters, so joining a batch allocates
+ * nothing. Every batch allocates the frames of its flush and of its call, and
+ * a vector of its keys. The batcher must outlive dispatched batches.
+ */
+template <typename K, typename V>
+class batcher {
+public:
+    using clock = timer_queue::clock;
+    using batch_fn = std::function<crt::async_fn<std::vector<V>>(std::span<const K>)>;
+
+    class load_awaiter {
+        friend class batcher;
+        batcher& owner;
+        K key;
+        std::optional<V> value;
+        std::exception_ptr error;
+        load_awaiter* next = nullptr;
+        std::coroutine_handle<> handle;
+
+    public:
+        load_awaiter(batcher& owner, K key) : owner(owner), key(std::move(key)) {}
+        load_awaiter(load_awaiter&& other) : owner(other.owner), key(std::move(other.key)) {}
+
+        constexpr bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> h) {
+            handle = h;
+            owner.join(this);
+        }
+        V await_resume() {
+            if (error) { std::rethrow_exception(error); }
+            return std::move(*value);
+        }
+    };
+
+private:
+    batch_fn fn;
+    executor_ref ex;
+    std::size_t max_batch;
+    clock::duration max_delay;
+
+    default_lock lock;
+    load_awaiter* head = nullptr;
+    load_awaiter* tail = nullptr;
+    std::size_t pending = 0;
+    // counts dispatched batches, so that a late flush skips later ones
+    std::uint64_t generation = 0;
+
+    // called with `lock` held
+    load_awaiter* detach() {
+        pending = 0;
+        tail = nullptr;
+        ++generation;
+        return std::exchange(head, nullptr);
+    }
+
+    void join(load_awaiter* w) {
+        load_awaiter* full = nullptr;
+        bool first = false;
+        std::uint64_t gen;
+        {
+            auto guard = std::lock_guard(lock);
+            if (tail) { tail->next = w; } else { head = w; }
+            tail = w;
+            first = ++pending == 1;
+            gen = generation;
+            if (pending >= max_batch) { full = detach(); }
+        }
+        if (full) { dispatch(*this, full).handle.resume(); }
+        else if (first) { flush_later(*this, gen).handle.resume(); }
+    }
+
+    static crt::agent flush_later(batcher& self, std::uint64_t gen) noexcept {
+        if (self.max_delay > clock::duration::zero()) {
+            co_await sleep_for(self.max_delay, self.ex);
+        } else {
+            co_await _::post_to{self.ex};
+        }
+        load_awaiter* batch = nullptr;
+        {
+            auto guard = std::lock_guard(self.lock);
+            if (self.generation == gen) { batch = self.detach(); }
+        }
+        if (batch) { dispatch(self, batch).handle.resume(); }
+    }
+
+    static crt::agent dispatch(batcher& self, load_awaiter* batch) noexcept {
+        std::exception_ptr error;
+        try {
+            std::vector<K> keys;
+            for (auto w = batch; w; w = w->next) { keys.push_back(w->key); }
+            auto values = co_await self.fn(std::span<const K>(keys));
+            if (values.size() != keys.size())
+                { throw std::length_error("batch function gave a wrong number of values"); }
+            std::size_t i = 0;
+            for (auto w = batch; w; w = w->next) { w->value.emplace(std::move(values[i++])); }
+        } catch (...) { error = std::current_exception(); }
+        while (batch) {
+            // a resumed waiter destroys its awaiter
+            auto w = std::exchange(batch, batch->next);
+            if (error) { w->error = error; }
+            _::dispatch(self.ex, w->handle);
+        }
+    }
+
+public:
+    /**
+     * @brief Throws `std::invalid_argument` when `ex` is null and `max_delay`
+     *        is not positive, as there is no tick to wait for then, unless
+     *        `max_batch` is 1 and batches never wait.
+     */
+    batcher(batch_fn fn, executor_ref ex, std::size_t max_batch = 64, clock::duration max_delay = clock::duration::zero()):
+        fn(std::move(fn)), ex(ex), max_batch(max_batch ? max_batch : 1), max_delay(max_delay) {
+        if (!ex && max_delay <= clock::duration::zero() && this->max_batch > 1)
+            { throw std::invalid_argument("a batcher without an executor needs a positive max_delay"); }
+    }
+
+    batcher(const batcher&) = delete;
+    batcher& operator=(const batcher&) = delete;
+
+    /**
+     * @brief Adds `key` to the current batch, and results in its value.
+     */
+    load_awaiter load(K key) { return load_awaiter(*this, std::move(key)); }
+};
+
+} // namespace coutils
+
+#endif // __COUTILS_BATCHER__
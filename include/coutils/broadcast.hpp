@@ -0,0 +1,332 @@
+#pragma once
+#ifndef __COUTILS_BROADCAST__
+#define __COUTILS_BROADCAST__
+
+#include <mutex>
+#include <memory>
+#include <cstdint>
+#include <optional>
+#include "coutils/utility.hpp"
+#include "coutils/traits.hpp"
+#include "coutils/crt/agent.hpp"
+#include "coutils/crt/async_generator.hpp"
+
+namespace coutils {
+
+/**
+ * @brief What `broadcast` does when its ring is full.
+ */
+enum class broadcast_policy {
+    // wait until the slowest subscriber releases the oldest item
+    throttle,
+    // overwrite the oldest item, lagging subscribers skip what they missed
+    drop_oldest,
+};
+
+/**
+ * @brief Multicasts items of one async generator to many subscribers.
+ *
+ * Items are moved from the generator into a shared ring of `capacity` slots
+ * once, and every subscriber reads them from the ring through its own cursor
+ * as `const value_type&`, so an item is never copied per subscriber.
+ *
+ * Create subscribers with `.subscribe()`, each of them is iterated like an
+ * async generator (e.g. with `COUTILS_FOR`). A subscriber starts from the next
+ * item produced after it subscribes, and the current item of a subscriber
+ * stays valid until the subscriber advances. An exception thrown by the
+ * generator is rethrown to every subscriber after the items before it.
+ *
+ * The generator is driven by an internal pump coroutine, which is started by
+ * a subscriber waiting for an item not produced yet, and runs on whichever
+ * thread resumes the generator. The pump resumes waiting subscribers inline
+ * when their item is ready. Under `broadcast_policy::throttle`, the pump reads
+ * ahead until the ring is full relative to the slowest subscriber. Under
+ * `broadcast_policy::drop_oldest`, the pump only reads on demand and
+ * overwrites items not held by any subscriber, see `subscriber::dropped()`.
+ *
+ * This must outlive its subscribers, but may be destroyed by a subscriber the
+ * pump is resuming, e.g. one reading to the end of the stream, in which case
+ * the pump finishes its step first. Creating it causes 3 heap allocations (1
+ * for the state shared with the pump, 1 for the ring and 1 for the pump
+ * coroutine), and each subscriber causes 1 more.
+ */
+template <typename G>
+class broadcast {
+    using _Source = decltype(std::declval<G&>().begin());
+    using _Item = decltype(*std::declval<_Source&>());
+
+public:
+    using value_type = std::remove_cvref_t<_Item>;
+
+private:
+    struct cursor {
+        cursor* prev = nullptr;
+        cursor* next = nullptr;
+        cursor* wake_next = nullptr;
+        std::coroutine_handle<> handle;
+        std::uint64_t seq = 0, dropped = 0;
+        bool holding = false, waiting = false, rethrown = false;
+    };
+
+    // Shared by the broadcast and the pump, so that a pump resuming a
+    // subscriber that destroys the broadcast can still finish its step.
+    struct core {
+        default_lock lock;
+        _Source source;
+        std::unique_ptr<std::optional<value_type>[]> ring;
+        std::size_t capacity;
+        broadcast_policy policy;
+        std::uint64_t produced = 0;
+        bool ended = false;
+        std::exception_ptr error;
+        cursor* cursors = nullptr;
+        std::size_t waiters = 0;
+        bool pump_running = false, pump_pending = false;
+        // set when the broadcast is destroyed, the pump then finishes
+        bool closed = false;
+        crt::agent_handle pump_handle;
+
+        core(G&& gen, std::size_t capacity, broadcast_policy policy):
+            source(gen.begin()),
+            ring(std::make_unique<std::optional<value_type>[]>(capacity)),
+            capacity(capacity), policy(policy) {}
+
+        // Following members should be accessed with `lock` held.
+
+        bool can_write() const {
+            for (auto c = cursors; c; c = c->next) {
+                if (policy == broadcast_policy::throttle) {
+                    if (produced >= c->seq + capacity) { return false; }
+                } else if (c->holding && produced == c->seq + capacity) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        bool can_pull() const {
+            if (ended || !cursors || !can_write()) { return false; }
+            return policy == broadcast_policy::throttle || waiters != 0;
+        }
+
+        bool keep_running() {
+            bool ok = pump_pending ? can_write() : can_pull();
+            if (!ok) { pump_running = false; }
+            return ok;
+        }
+
+        bool should_restart() {
+            if (pump_running || closed) { return false; }
+            bool ok = pump_pending ? can_write() : can_pull() && waiters != 0;
+            if (ok) { pump_running = true; }
+            return ok;
+        }
+
+        cursor* collect_waiting() {
+            cursor* wake = nullptr;
+            for (auto c = cursors; c; c = c->next) {
+                if (!c->waiting || (c->seq >= produced && !ended)) { continue; }
+                c->waiting = false; --waiters;
+                c->holding = c->seq < produced;
+                c->wake_next = std::exchange(wake, c);
+            }
+            return wake;
+        }
+
+        // Following members are only called by the pump.
+
+        static void wake_all(cursor* wake) {
+            while (wake) {
+                // a subscriber may be gone once resumed
+                auto c = std::exchange(wake, wake->wake_next);
+                c->handle.resume();
+            }
+        }
+
+        bool on_pulled() {
+            cursor* wake = nullptr;
+            {
+                auto guard = std::lock_guard(lock);
+                if (!source.done()) { pump_pending = true; return true; }
+                ended = true;
+                // rethrows exception of the generator
+                if (source != std::default_sentinel) try {
+                    (void)*source;
+                } catch (...) { error = std::current_exception(); }
+                wake = collect_waiting();
+            }
+            wake_all(wake);
+            return false;
+        }
+
+        void publish() {
+            cursor* wake = nullptr;
+            {
+                auto guard = std::lock_guard(lock);
+                auto& slot = ring[produced % capacity];
+                slot.emplace(source.take());
+                ++produced; pump_pending = false;
+                wake = collect_waiting();
+            }
+            wake_all(wake);
+        }
+
+        /**
+         * @brief Parks the pump when it should not go on, results in whether
+         *        the broadcast is destroyed.
+         */
+        struct pump_gate {
+            core& self;
+            bool closed = false;
+            constexpr bool await_ready() const noexcept { return false; }
+            bool await_suspend(std::coroutine_handle<>) {
+                auto guard = std::lock_guard(self.lock);
+                if (self.closed) { closed = true; return false; }
+                return !self.keep_running();
+            }
+            bool await_resume() const noexcept { return closed; }
+        };
+
+        // GCC 12 miscompiles `co_await` in the condition of `if` here, so
+        // the results of gates are named first.
+        static crt::agent pump(std::shared_ptr<core> self) noexcept {
+            while (true) {
+                bool closed = co_await pump_gate{*self};
+                if (closed) { co_return; }
+                co_await self->source;
+                if (!self->on_pulled()) { continue; }
+                closed = co_await pump_gate{*self};
+                if (closed) { co_return; }
+                self->publish();
+            }
+        }
+
+        // Following members are called by subscribers.
+
+        void attach(cursor& c) {
+            auto guard = std::lock_guard(lock);
+            c.seq = produced;
+            c.next = std::exchange(cursors, &c);
+            if (c.next) { c.next->prev = &c; }
+        }
+
+        void detach(cursor& c) {
+            bool restart;
+            {
+                auto guard = std::lock_guard(lock);
+                if (c.prev) { c.prev->next = c.next; }
+                else { cursors = c.next; }
+                if (c.next) { c.next->prev = c.prev; }
+                restart = should_restart();
+            }
+            if (restart) { pump_handle.resume(); }
+        }
+
+        std::coroutine_handle<> advance(cursor& c, std::coroutine_handle<> h) {
+            bool suspend = false, restart;
+            {
+                auto guard = std::lock_guard(lock);
+                if (std::exchange(c.holding, false)) { ++c.seq; }
+                if (policy == broadcast_policy::drop_oldest && produced > capacity) {
+                    auto oldest = produced - capacity;
+                    if (c.seq < oldest)
+                        { c.dropped += oldest - c.seq; c.seq = oldest; }
+                }
+                if (c.seq < produced) { c.holding = true; }
+                else if (!ended) {
+                    c.waiting = true; c.handle = h; ++waiters;
+                    suspend = true;
+                }
+                restart = should_restart();
+            }
+            if (suspend) {
+                if (restart) { return pump_handle; }
+                return std::noop_coroutine();
+            }
+            if (restart) { pump_handle.resume(); }
+            return h;
+        }
+
+        void on_resume(cursor& c) {
+            if (c.holding || !error || c.rethrown) { return; }
+            c.rethrown = true;
+            std::rethrow_exception(error);
+        }
+    };
+
+    std::shared_ptr<core> st;
+
+public:
+    broadcast(G&& gen, std::size_t capacity,
+        broadcast_policy policy = broadcast_policy::throttle):
+        st(std::make_shared<core>(std::move(gen), capacity ? capacity : 1, policy))
+        { st->pump_handle = core::pump(st).handle; }
+
+    ~broadcast() {
+        bool idle;
+        {
+            auto guard = std::lock_guard(st->lock);
+            st->closed = true;
+            idle = !st->pump_running;
+        }
+        // a running pump finishes by itself once it sees `closed`, keeping
+        // the core alive until then
+        if (idle) { st->pump_handle.destroy(); }
+    }
+
+    broadcast(const broadcast&) = delete;
+    broadcast& operator=(const broadcast&) = delete;
+
+    class subscriber {
+        core* parent;
+        std::unique_ptr<cursor> state;
+
+    public:
+        subscriber(core& parent):
+            parent(std::addressof(parent)), state(std::make_unique<cursor>())
+            { parent.attach(*state); }
+        ~subscriber() { if (state) { parent->detach(*state); } }
+
+        subscriber(subscriber&&) = default;
+
+        /**
+         * @brief Number of items this subscriber has missed.
+         *
+         * Only `broadcast_policy::drop_oldest` drops items.
+         */
+        std::uint64_t dropped() const noexcept { return state->dropped; }
+
+        class iterator {
+            core* parent;
+            cursor* state;
+
+        public:
+            iterator(core* parent, cursor* state):
+                parent(parent), state(state) {}
+
+            bool operator==(std::default_sentinel_t) const
+                { return !state->holding; }
+            const value_type& operator*() const
+                { return *parent->ring[state->seq % parent->capacity]; }
+            const value_type* operator->() const { return std::addressof(**this); }
+            iterator& operator++() & { return *this; }
+
+            constexpr bool await_ready() const noexcept { return false; }
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> ch)
+                { return parent->advance(*state, ch); }
+            void await_resume() { parent->on_resume(*state); }
+        };
+
+        iterator begin() { return iterator(parent, state.get()); }
+        decltype(auto) end() const { return std::default_sentinel; }
+    };
+
+    subscriber subscribe() { return subscriber(*st); }
+};
+
+template <typename G>
+broadcast(G&&, auto&&...) -> broadcast<G>;
+
+} // namespace coutils
+
+#endif // __COUTILS_BROADCAST__
@@ -4,6 +4,9 @@
 
 #include "../utility.hpp"
 #include "../traits.hpp"
+#ifdef COUTILS_FRAME_TELEMETRY
+#include "./frame_telemetry.hpp"
+#endif
 
 namespace coutils::crt {
 
@@ -15,6 +18,13 @@ struct agent_promise {
         { return std::suspend_always{}; }
     decltype(auto) final_suspend() noexcept
         { return std::suspend_never{}; }
+
+#ifdef COUTILS_FRAME_TELEMETRY
+    static void* operator new(std::size_t n)
+        { return _::frame_stats::of<agent_promise>().allocate(n); }
+    static void operator delete(void* ptr, std::size_t n) noexcept
+        { _::frame_stats::deallocate(ptr, n); }
+#endif
 };
 
 using agent_handle = std::coroutine_handle<agent_promise>;
@@ -2,42 +2,210 @@
 #ifndef __COUTILS_CRT_ASYNC_FN__
 #define __COUTILS_CRT_ASYNC_FN__
 
+#include <optional>
+#include <source_location>
 #include "./zygote.hpp"
+#include "../executor.hpp"
 
 namespace coutils::crt {
 
+/**
+ * @brief Location of an `async_fn`, linked to the `async_fn` awaiting it.
+ */
+struct async_frame {
+    const async_frame* parent = nullptr;
+    std::source_location location;
+};
+
+#ifdef COUTILS_ASYNC_SAMPLING
+namespace _ {
+
+// The `async_fn` running on this thread, null when it is unknown.
+inline thread_local const async_frame* current_frame = nullptr;
+
+/**
+ * @brief Wraps an awaiter to track `current_frame` across suspension.
+ */
+template <typename A>
+class tracked_awaiter {
+    A inner;
+    const async_frame* frame;
+
+public:
+    tracked_awaiter(A&& inner, const async_frame* frame):
+        inner(COUTILS_FWD(inner)), frame(frame) {}
+
+    bool await_ready() { return inner.await_ready(); }
+    decltype(auto) await_suspend(auto h) {
+        // the frame may be resumed elsewhere before `inner` returns
+        current_frame = nullptr;
+        return inner.await_suspend(h);
+    }
+    decltype(auto) await_resume() {
+        current_frame = frame;
+        return inner.await_resume();
+    }
+};
+
+} // namespace _
+#endif
+
 template <typename T>
 struct async_fn_promise: zygote_promise<async_fn_promise<T>, zygote_disable, zygote_disable, T> {
+    using _Base = zygote_promise<async_fn_promise<T>, zygote_disable, zygote_disable, T>;
+    using _Slot = std::conditional_t<non_value<T>, std::nullptr_t, std::optional<T>*>;
+
     std::coroutine_handle<> caller = {};
-    decltype(auto) final_suspend() noexcept
-        { return transfer_to_handle{std::exchange(caller, {})}; }
+    // executor running `caller` when it awaited this
+    executor_ref home = {};
+    // when set, `co_return` constructs the result here instead
+    _Slot destination = nullptr;
+    async_frame frame;
+    // inherited from `caller` when it has one
+    schedule_hint hint = {};
+
+    async_fn_promise(std::source_location loc) : frame{nullptr, loc} {}
+
+    decltype(auto) final_suspend() noexcept {
+#ifdef COUTILS_ASYNC_SAMPLING
+        // this frame may be freed once suspended, an `async_fn` caller sets
+        // its own frame again when resumed
+        _::current_frame = nullptr;
+#endif
+        return transfer_on_executor{std::exchange(caller, {}), home};
+    }
+
+#ifdef COUTILS_ASYNC_SAMPLING
+    decltype(auto) initial_suspend() noexcept {
+        return _::tracked_awaiter<std::suspend_always>({}, &frame);
+    }
+
+    template <traits::awaitable A>
+    decltype(auto) await_transform(A&& obj) {
+        using _Awaiter = decltype(ops::get_awaiter(COUTILS_FWD(obj)));
+        return _::tracked_awaiter<_Awaiter>(ops::get_awaiter(COUTILS_FWD(obj)), &frame);
+    }
+#endif
+
+    void set_returned(auto&& expr) noexcept {
+        if constexpr (!non_value<T>) {
+            if (destination) try {
+                using Expr = std::remove_cvref_t<decltype(expr)>;
+                if constexpr (is_initializer_mark_v<Expr>) {
+                    std::apply([&](auto&&... args) {
+                        destination->emplace(COUTILS_FWD(args)...);
+                    }, COUTILS_FWD(expr).data);
+                } else {
+                    destination->emplace(COUTILS_FWD(expr));
+                }
+                return;
+            } catch (...) { this->unhandled_exception(); return; }
+        }
+        _Base::set_returned(COUTILS_FWD(expr));
+    }
 };
 
 template <typename T>
 using async_fn_handle = std::coroutine_handle<async_fn_promise<T>>;
 
+/**
+ * @brief Result of awaiting an `async_fn` whose result is not reconstructible.
+ *
+ * Owns the finished callee, and refers to the result in its promise.
+ */
+template <typename T>
+class async_fn_result {
+    owning_handle<async_fn_promise<T>> handle;
+
+public:
+    explicit async_fn_result(owning_handle<async_fn_promise<T>>&& handle):
+        handle(std::move(handle)) {}
+
+    T& get() const noexcept { return handle.promise().get_returned(); }
+    T& operator*() const noexcept { return get(); }
+    T* operator->() const noexcept { return std::addressof(get()); }
+};
+
 /**
  * @brief Wraps coroutine as a lazy async function.
  * 
  * `co_return coutils::co_result(...)` can be used as an equivalent of `return {...}`.
  * 
+ * When the caller runs on an executor (see `current_executor()`) and the
+ * callee finishes elsewhere, the caller is posted back to its executor.
+ * 
  * Note: When copy or move contructor is available, returned object will be at
  *       least constructed once and moved once. Otherwise, the result of
  *       `co_await` expression will be a wrapper of callee's handle, where a
- *       reference of returned object can be obtained.
+ *       reference of returned object can be obtained. To construct returned
+ *       object directly in storage of the caller, use `co_await fn.into(slot)`.
  */
 template <typename T>
 class async_fn {
+    using enum promise_state;
     using _Ops = zygote_ops<async_fn_promise<T>>;
     owning_handle<async_fn_promise<T>> handle;
 
+    template <typename P>
+    static void link_caller(async_fn_promise<T>& p, std::coroutine_handle<P> ch) noexcept {
+        p.caller = ch; p.home = current_executor();
+        if constexpr (requires { { ch.promise().frame } -> std::same_as<async_frame&>; })
+            { p.frame.parent = &ch.promise().frame; }
+        if constexpr (requires { { ch.promise().hint } -> std::same_as<schedule_hint&>; })
+            { p.hint = ch.promise().hint; }
+    }
+
 public:
     async_fn(async_fn_promise<T>& p) : handle(p) {}
 
     constexpr bool await_ready() const noexcept { return false; }
-    std::coroutine_handle<> await_suspend(std::coroutine_handle<> ch)
-        { handle.promise().caller = ch; return handle; }
-    decltype(auto) await_resume() { return _Ops::move_out_returned(handle); }
+    template <typename P>
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<P> ch) {
+        auto& p = handle.promise();
+        link_caller(p, ch);
+        return handle;
+    }
+    decltype(auto) await_resume() {
+        if constexpr (non_value<T> || reconstructible<T>) {
+            return _Ops::move_out_returned(handle);
+        } else {
+            handle.promise().template check_value<RETURNED>();
+            return async_fn_result<T>(std::move(handle));
+        }
+    }
+
+    class into_awaiter {
+        owning_handle<async_fn_promise<T>> handle;
+        std::optional<T>* slot;
+
+    public:
+        into_awaiter(owning_handle<async_fn_promise<T>>&& handle, std::optional<T>& slot):
+            handle(std::move(handle)), slot(std::addressof(slot)) {}
+        into_awaiter(into_awaiter&&) = default;
+
+        constexpr bool await_ready() const noexcept { return false; }
+        template <typename P>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<P> ch) {
+            auto& p = handle.promise();
+            p.destination = slot; link_caller(p, ch);
+            return handle;
+        }
+        void await_resume() { handle.promise().check_error(); }
+    };
+
+    /**
+     * @brief Awaits this with `co_return` constructing the result in `slot`.
+     *
+     * The result is constructed once in place and never moved, so it works
+     * for any destructible type. `slot` is reset before the call starts.
+     */
+    into_awaiter into(std::optional<T>& slot) && requires (!non_value<T>)
+        { slot.reset(); return into_awaiter(std::move(handle), slot); }
+
+    /**
+     * @brief Releases ownership of the underlying coroutine.
+     */
+    async_fn_handle<T> release() noexcept { return handle.transfer(); }
 };
 
 } // namespace coutils::crt
@@ -41,6 +41,8 @@ public:
             { _Ops::check_error(handle); return _Ops::yielded(handle); }
         decltype(auto) operator->() { return std::addressof(*(*this)); }
         iterator& operator++() & noexcept { return *this; }
+        decltype(auto) take() { return static_cast<Y&&>(*(*this)); }
+        bool done() const noexcept { return handle.done(); }
 
         constexpr bool await_ready() const noexcept { return false; }
         std::coroutine_handle<> await_suspend(std::coroutine_handle<> ch)
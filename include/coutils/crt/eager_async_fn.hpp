@@ -0,0 +1,81 @@
+#pragma once
+#ifndef __COUTILS_CRT_EAGER_ASYNC_FN__
+#define __COUTILS_CRT_EAGER_ASYNC_FN__
+
+#include <atomic>
+#include "./zygote.hpp"
+
+namespace coutils::crt {
+
+template <typename T>
+struct eager_async_fn_promise: zygote_promise<eager_async_fn_promise<T>, zygote_disable, zygote_disable, T> {
+    using enum std::memory_order;
+
+    // `caller` is null, the address of the awaiting coroutine, or the address
+    // of this promise after the coroutine finishes.
+    std::atomic<void*> caller = nullptr;
+
+    struct final_awaiter {
+        constexpr bool await_ready() const noexcept { return false; }
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<> h) const noexcept {
+            auto& p = handle_cast<eager_async_fn_promise>(h).promise();
+            auto c = p.caller.exchange(std::addressof(p), acq_rel);
+            if (c) { return std::coroutine_handle<>::from_address(c); }
+            return std::noop_coroutine();
+        }
+        constexpr void await_resume() const noexcept {}
+    };
+
+    decltype(auto) initial_suspend() noexcept { return std::suspend_never{}; }
+    decltype(auto) final_suspend() noexcept { return final_awaiter{}; }
+
+    bool finished() const noexcept
+        { return caller.load(acquire) == static_cast<const void*>(this); }
+
+    /**
+     * @brief Sets the awaiting coroutine, returns false if already finished.
+     */
+    bool set_caller(std::coroutine_handle<> h) noexcept {
+        void* expected = nullptr;
+        return caller.compare_exchange_strong(expected, h.address(), acq_rel, acquire);
+    }
+};
+
+template <typename T>
+using eager_async_fn_handle = std::coroutine_handle<eager_async_fn_promise<T>>;
+
+/**
+ * @brief Wraps coroutine as an eager async function.
+ *
+ * Unlike `async_fn`, the coroutine runs on creation until it first suspends.
+ * If it finishes without suspending, awaiting it does not suspend the caller
+ * either, so a fast path (e.g. a cache hit) costs about a plain function call.
+ * Otherwise, the caller is resumed by whoever finishes the coroutine.
+ *
+ * It should be awaited, or already finished, when destroyed.
+ */
+template <typename T>
+class eager_async_fn {
+    using _Ops = zygote_ops<eager_async_fn_promise<T>>;
+    owning_handle<eager_async_fn_promise<T>> handle;
+
+public:
+    eager_async_fn(eager_async_fn_promise<T>& p) : handle(p) {}
+
+    bool await_ready() const noexcept { return handle.promise().finished(); }
+    bool await_suspend(std::coroutine_handle<> ch)
+        { return handle.promise().set_caller(ch); }
+    decltype(auto) await_resume() { return _Ops::move_out_returned(handle); }
+};
+
+} // namespace coutils::crt
+
+template <typename T, typename... Args>
+struct std::coroutine_traits<coutils::crt::eager_async_fn<T>, Args...> {
+    using promise_type = coutils::promise_bridge<
+        coutils::crt::eager_async_fn<T>,
+        coutils::crt::eager_async_fn_promise<T>
+    >;
+};
+
+#endif // __COUTILS_CRT_EAGER_ASYNC_FN__
@@ -0,0 +1,172 @@
+#pragma once
+#ifndef __COUTILS_CRT_FRAME_TELEMETRY__
+#define __COUTILS_CRT_FRAME_TELEMETRY__
+
+#include <new>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string_view>
+#include <source_location>
+
+namespace coutils::crt {
+
+/**
+ * @brief Frame allocation statistics of one coroutine promise type, i.e. of
+ *        all coroutine functions returning the same type.
+ */
+struct frame_stats_report {
+    static constexpr std::size_t buckets = 32;
+
+    std::string name;
+    std::size_t allocations = 0, frees = 0, cross_thread_frees = 0;
+    std::size_t total_bytes = 0, max_bytes = 0;
+    std::chrono::nanoseconds total_lifetime{};
+    // count of frames of at most `2^i` bytes and more than `2^(i-1)` bytes
+    std::array<std::size_t, buckets> size_histogram{};
+
+    std::size_t live() const noexcept { return allocations - frees; }
+    double cross_thread_ratio() const noexcept
+        { return frees ? double(cross_thread_frees) / double(frees) : 0.0; }
+    std::chrono::nanoseconds mean_lifetime() const noexcept
+        { return frees ? total_lifetime / std::int64_t(frees) : std::chrono::nanoseconds{}; }
+};
+
+namespace _ {
+
+class frame_stats {
+    using enum std::memory_order;
+    using _Clock = std::chrono::steady_clock;
+    static constexpr std::size_t buckets = frame_stats_report::buckets;
+
+    const char* signature;
+    frame_stats* next = nullptr;
+    std::atomic<std::size_t> allocations = 0, frees = 0, cross_thread_frees = 0;
+    std::atomic<std::size_t> total_bytes = 0, max_bytes = 0;
+    std::atomic<_Clock::rep> total_lifetime = 0;
+    std::array<std::atomic<std::size_t>, buckets> size_histogram{};
+
+    struct alignas(__STDCPP_DEFAULT_NEW_ALIGNMENT__) header {
+        frame_stats* stats;
+        _Clock::rep born;
+        std::thread::id thread;
+    };
+
+    static std::atomic<frame_stats*>& registry() {
+        static std::atomic<frame_stats*> head = nullptr;
+        return head;
+    }
+
+    static std::size_t bucket_of(std::size_t n) noexcept {
+        std::size_t i = 0;
+        while (i + 1 < buckets && (std::size_t(1) << i) < n) { ++i; }
+        return i;
+    }
+
+public:
+    explicit frame_stats(const char* signature) : signature(signature) {
+        auto& head = registry();
+        next = head.load(relaxed);
+        while (!head.compare_exchange_weak(next, this, release, relaxed)) {}
+    }
+
+    template <typename P>
+    static frame_stats& of() {
+        static frame_stats stats(std::source_location::current().function_name());
+        return stats;
+    }
+
+    void* allocate(std::size_t n) {
+        auto h = static_cast<header*>(::operator new(sizeof(header) + n));
+        new (h) header{this, _Clock::now().time_since_epoch().count(), std::this_thread::get_id()};
+        allocations.fetch_add(1, relaxed);
+        total_bytes.fetch_add(n, relaxed);
+        auto max = max_bytes.load(relaxed);
+        while (max < n && !max_bytes.compare_exchange_weak(max, n, relaxed)) {}
+        size_histogram[bucket_of(n)].fetch_add(1, relaxed);
+        return h + 1;
+    }
+
+    static void deallocate(void* ptr, std::size_t n) noexcept {
+        auto h = static_cast<header*>(ptr) - 1;
+        auto& self = *h->stats;
+        auto lifetime = _Clock::now().time_since_epoch().count() - h->born;
+        self.frees.fetch_add(1, relaxed);
+        self.total_lifetime.fetch_add(lifetime, relaxed);
+        if (h->thread != std::this_thread::get_id())
+            { self.cross_thread_frees.fetch_add(1, relaxed); }
+        ::operator delete(h, sizeof(header) + n);
+    }
+
+    static std::vector<frame_stats_report> report() {
+        std::vector<frame_stats_report> result;
+        for (auto s = registry().load(acquire); s; s = s->next) {
+            frame_stats_report r;
+            // `signature` is the signature of `of<P>`, keep the part naming `P`
+            std::string_view sig = s->signature;
+            auto begin = sig.find("P = ");
+            if (begin != sig.npos) {
+                sig.remove_prefix(begin + 4);
+                sig = sig.substr(0, sig.find_first_of(";]"));
+            }
+            r.name = sig;
+            r.allocations = s->allocations.load(relaxed);
+            r.frees = s->frees.load(relaxed);
+            r.cross_thread_frees = s->cross_thread_frees.load(relaxed);
+            r.total_bytes = s->total_bytes.load(relaxed);
+            r.max_bytes = s->max_bytes.load(relaxed);
+            r.total_lifetime = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                _Clock::duration(s->total_lifetime.load(relaxed)));
+            for (std::size_t i = 0; i < buckets; ++i)
+                { r.size_histogram[i] = s->size_histogram[i].load(relaxed); }
+            result.push_back(std::move(r));
+        }
+        return result;
+    }
+};
+
+} // namespace _
+
+/**
+ * @brief Gets frame allocation statistics of every promise type allocated
+ *        so far.
+ *
+ * Only available when `COUTILS_FRAME_TELEMETRY` is defined, which makes
+ * promises of `zygote_promise` and `agent` count frame sizes, lifetimes and
+ * frees on a thread other than the allocating one. Otherwise promises use
+ * plain `operator new` and nothing is recorded.
+ *
+ * Statistics are kept per promise type, not per coroutine function, since a
+ * frame is allocated before anything knows which function it belongs to. So
+ * e.g. every `async_fn<int>` shares one report, and the size histogram tells
+ * apart functions of one type with different frame sizes.
+ */
+inline std::vector<frame_stats_report> frame_telemetry() {
+    return _::frame_stats::report();
+}
+
+/**
+ * @brief Writes `frame_telemetry()` in a human readable form.
+ */
+inline void print_frame_telemetry(std::ostream& out) {
+    for (auto&& r : frame_telemetry()) {
+        out << r.name << ": " << r.allocations << " frames, " << r.live() << " live, "
+            << (r.allocations ? r.total_bytes / r.allocations : 0) << " bytes mean, "
+            << r.max_bytes << " bytes max, " << r.mean_lifetime().count() << " ns mean lifetime, "
+            << r.cross_thread_ratio() * 100 << "% freed on another thread\n";
+        for (std::size_t i = 0; i < r.size_histogram.size(); ++i) {
+            if (!r.size_histogram[i]) { continue; }
+            out << "  <= " << (std::size_t(1) << i) << " bytes: " << r.size_histogram[i] << '\n';
+        }
+    }
+}
+
+} // namespace coutils::crt
+
+#endif // __COUTILS_CRT_FRAME_TELEMETRY__
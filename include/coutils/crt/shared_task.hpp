@@ -0,0 +1,150 @@
+#pragma once
+#ifndef __COUTILS_CRT_SHARED_TASK__
+#define __COUTILS_CRT_SHARED_TASK__
+
+#include <atomic>
+#include <cstdint>
+#include "./zygote.hpp"
+
+namespace coutils::crt {
+
+template <typename T>
+struct shared_task_promise: zygote_promise<shared_task_promise<T>, zygote_disable, zygote_disable, T> {
+    using enum std::memory_order;
+
+    struct waiter {
+        waiter* next = nullptr;
+        std::coroutine_handle<> handle;
+    };
+
+    // `state` is `NOT_STARTED`, `DONE`, or the top of a stack of waiters
+    // pushed while the coroutine is running.
+    static constexpr std::uintptr_t NOT_STARTED = 0, DONE = 1;
+
+    std::atomic<std::uintptr_t> state = NOT_STARTED;
+    std::atomic<std::size_t> refs = 1;
+
+    struct final_awaiter {
+        constexpr bool await_ready() const noexcept { return false; }
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<> h) const noexcept {
+            // A resumed waiter may destroy this frame, so only locals are used
+            // after the exchange.
+            auto& p = handle_cast<shared_task_promise>(h).promise();
+            auto top = p.state.exchange(DONE, acq_rel);
+            auto w = reinterpret_cast<waiter*>(top);
+            while (w && w->next) {
+                std::exchange(w, w->next)->handle.resume();
+            }
+            return w ? w->handle : std::noop_coroutine();
+        }
+        constexpr void await_resume() const noexcept {}
+    };
+
+    decltype(auto) final_suspend() noexcept { return final_awaiter{}; }
+
+    /**
+     * @brief Pushes `w` as a waiter, returns the handle to transfer to.
+     *
+     * The first waiter starts the coroutine.
+     */
+    std::coroutine_handle<> add_waiter(waiter& w) {
+        using _Handle = std::coroutine_handle<shared_task_promise>;
+        auto top = state.load(acquire);
+        while (true) {
+            if (top == DONE) { return w.handle; }
+            w.next = top == NOT_STARTED ? nullptr : reinterpret_cast<waiter*>(top);
+            auto desired = reinterpret_cast<std::uintptr_t>(&w);
+            if (state.compare_exchange_weak(top, desired, acq_rel, acquire)) {
+                if (top != NOT_STARTED) { return std::noop_coroutine(); }
+                return _Handle::from_promise(*this);
+            }
+        }
+    }
+};
+
+template <typename T>
+using shared_task_handle = std::coroutine_handle<shared_task_promise<T>>;
+
+/**
+ * @brief A lazy coroutine whose result can be awaited any number of times.
+ *
+ * Copies of a `shared_task` share one coroutine frame, which is destroyed
+ * with the last copy. The coroutine is started by the first awaiter, and
+ * later awaiters push themselves onto a lock-free intrusive stack stored in
+ * the awaiters, so awaiting allocates nothing. When the coroutine finishes,
+ * all waiters are resumed on the finishing thread, and awaiters coming after
+ * that do not suspend at all.
+ *
+ * The result of `co_await` is a `const T&` into the shared frame, which is
+ * valid as long as any copy of this is alive. An exception thrown by the
+ * coroutine is rethrown to every awaiter.
+ */
+template <typename T>
+class shared_task {
+    using enum std::memory_order;
+    using enum promise_state;
+    using _Promise = shared_task_promise<T>;
+    shared_task_handle<T> handle;
+
+    void unref() {
+        if (handle && handle.promise().refs.fetch_sub(1, acq_rel) == 1)
+            { handle.destroy(); }
+    }
+
+public:
+    shared_task(_Promise& p) : handle(shared_task_handle<T>::from_promise(p)) {}
+    ~shared_task() { unref(); }
+
+    shared_task(const shared_task& other) noexcept : handle(other.handle)
+        { if (handle) { handle.promise().refs.fetch_add(1, relaxed); } }
+    shared_task(shared_task&& other) noexcept :
+        handle(std::exchange(other.handle, {})) {}
+    shared_task& operator=(shared_task other) noexcept
+        { std::swap(handle, other.handle); return *this; }
+
+    /**
+     * @brief Checks if the coroutine has finished.
+     */
+    bool ready() const noexcept
+        { return handle.promise().state.load(acquire) == _Promise::DONE; }
+
+    class awaiter {
+        shared_task_handle<T> handle;
+        typename _Promise::waiter node;
+
+    public:
+        awaiter(shared_task_handle<T> h) noexcept : handle(h) {}
+        awaiter(awaiter&& other) noexcept : handle(other.handle) {}
+
+        bool await_ready() const noexcept
+            { return handle.promise().state.load(acquire) == _Promise::DONE; }
+
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<> ch) {
+            node.handle = ch;
+            return handle.promise().add_waiter(node);
+        }
+
+        decltype(auto) await_resume() const {
+            auto& p = handle.promise();
+            p.template check_value<RETURNED>();
+            if constexpr (std::is_void_v<T>) { return; }
+            else if constexpr (std::is_reference_v<T>)
+                { return static_cast<T>(p.get_returned()); }
+            else { return static_cast<const T&>(p.get_returned()); }
+        }
+    };
+
+    awaiter operator co_await() const noexcept { return awaiter(handle); }
+};
+
+} // namespace coutils::crt
+
+template <typename T, typename... Args>
+struct std::coroutine_traits<coutils::crt::shared_task<T>, Args...> {
+    using promise_type = coutils::promise_bridge<
+        coutils::crt::shared_task<T>,
+        coutils::crt::shared_task_promise<T>
+    >;
+};
+
+#endif // __COUTILS_CRT_SHARED_TASK__
@@ -0,0 +1,136 @@
+#pragma once
+#ifndef __COUTILS_CRT_SINK__
+#define __COUTILS_CRT_SINK__
+
+#include <span>
+#include <optional>
+#include "./zygote.hpp"
+
+namespace coutils::crt {
+
+/**
+ * @brief Tag awaited in a `sink` for its next input.
+ */
+struct next_input_t { explicit next_input_t() = default; };
+inline constexpr next_input_t next_input{};
+
+template <typename S, typename R>
+struct sink_promise : zygote_promise<sink_promise<S, R>, void, S, R> {
+    using enum promise_state;
+
+    // set by `sink::close`, makes `next_input` result in `std::nullopt`
+    bool closed = false;
+
+    class input_awaiter {
+        sink_promise& p;
+    public:
+        input_awaiter(sink_promise& p) : p(p) {}
+        bool await_ready() const noexcept { return p.closed; }
+        void await_suspend(std::coroutine_handle<>) noexcept
+            { p.set_yielded(std::monostate{}); }
+        std::optional<S> await_resume() {
+            if (p.closed) { return std::nullopt; }
+            p.template check_value<RECEIVED>();
+            return std::optional<S>(std::move(p.get_received()));
+        }
+    };
+
+    input_awaiter await_transform(next_input_t) { return input_awaiter(*this); }
+    void await_transform(auto&&) = delete;
+};
+
+template <typename S, typename R>
+using sink_handle = std::coroutine_handle<sink_promise<S, R>>;
+
+/**
+ * @brief A coroutine consuming values pushed into it.
+ *
+ * The body gets every value with `co_await next_input`, which results in
+ * `std::optional<S>`, and `std::nullopt` after `close` is called. Each `push`
+ * resumes the body on calling thread until it asks for the next value or
+ * finishes, so the body runs as an incremental parser or state machine driven
+ * by its producer, without buffering input. The body cannot await anything
+ * else.
+ *
+ * `S` should be an object type. To feed chunks of bytes without copying, make
+ * it a view like `std::span<const std::byte>` or `std::string_view`, which
+ * should stay valid until `push` returns.
+ *
+ * The frame is allocated when the coroutine is called, and the body starts
+ * running on the first `push` or `close`. Exceptions thrown by the body are
+ * rethrown by the `push` or `close` resuming it.
+ */
+template <typename S, typename R = void>
+class sink {
+    static_assert(std::is_object_v<S>, "sink input type should be an object type");
+
+    using enum promise_state;
+    using _Promise = sink_promise<S, R>;
+    using _Ops = zygote_ops<_Promise>;
+    owning_handle<_Promise> handle;
+
+    void start() { if (_Ops::status(handle) == PENDING) { handle.resume(); } }
+
+public:
+    sink(_Promise& p) : handle(p) {}
+
+    /**
+     * @brief Checks whether the body finished.
+     */
+    bool done() const noexcept { return handle.done(); }
+
+    /**
+     * @brief Gives `value` to the body and runs it until it asks for the next
+     *        one, gets whether the body took it.
+     *
+     * Gets false when the body already finished.
+     */
+    bool push(auto&& value) {
+        start();
+        _Ops::check_error(handle);
+        if (handle.done() || handle.promise().closed) { return false; }
+        _Ops::send(handle, COUTILS_FWD(value));
+        handle.resume();
+        _Ops::check_error(handle);
+        return true;
+    }
+
+    /**
+     * @brief Pushes elements of `items` in order, gets how many the body took
+     *        before finishing.
+     */
+    template <typename T>
+    std::size_t push_span(std::span<T> items) {
+        std::size_t taken = 0;
+        for (auto&& item : items) {
+            if (!push(item)) { break; }
+            ++taken;
+        }
+        return taken;
+    }
+
+    /**
+     * @brief Ends the input, runs the body to its end and gets its result.
+     */
+    decltype(auto) close() {
+        start();
+        if (!handle.done()) {
+            handle.promise().closed = true;
+            handle.resume();
+        }
+        if constexpr (std::is_void_v<R>) { handle.promise().template check_value<RETURNED>(); }
+        else { return _Ops::move_out_returned(handle); }
+    }
+};
+
+} // namespace coutils::crt
+
+template <typename S, typename R, typename... Args>
+struct std::coroutine_traits<coutils::crt::sink<S, R>, Args...> {
+    using promise_type = coutils::promise_bridge<
+        coutils::crt::sink<S, R>,
+        coutils::crt::sink_promise<S, R>
+    >;
+};
+
+#endif // __COUTILS_CRT_SINK__
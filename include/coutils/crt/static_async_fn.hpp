@@ -0,0 +1,153 @@
+#pragma once
+#ifndef __COUTILS_CRT_STATIC_ASYNC_FN__
+#define __COUTILS_CRT_STATIC_ASYNC_FN__
+
+#include <new>
+#include <cstddef>
+#include <exception>
+#include "./async_fn.hpp"
+
+namespace coutils::crt {
+
+/**
+ * @brief What `static_async_fn` does when a frame does not fit in its block.
+ */
+enum class frame_overflow {
+    // allocate the frame on heap as usual
+    heap,
+    // call `std::terminate`
+    terminate,
+};
+
+/**
+ * @brief A fixed-size block holding one coroutine frame.
+ *
+ * Pass one by non-const reference as an argument of a `static_async_fn` with the same
+ * `Bytes` to place its frame here. The block must outlive the coroutine and
+ * hold only one frame at a time.
+ */
+template <std::size_t Bytes>
+struct frame_buffer {
+    alignas(__STDCPP_DEFAULT_NEW_ALIGNMENT__) std::byte data[Bytes];
+    frame_buffer* next = nullptr;
+    bool pooled = false, busy = false;
+
+    frame_buffer() noexcept {}
+    frame_buffer(const frame_buffer&) = delete;
+    frame_buffer& operator=(const frame_buffer&) = delete;
+};
+
+namespace _ {
+
+template <std::size_t Bytes>
+class frame_pool {
+    using _Block = frame_buffer<Bytes>;
+    // The pool itself is trivially destructible, so that frames freed after
+    // `reaper` emptied it at thread exit still find it, and delete their
+    // blocks instead of pooling them.
+    _Block* head = nullptr;
+    bool closed = false;
+
+    struct reaper {
+        ~reaper() {
+            auto& pool = local();
+            pool.closed = true;
+            while (pool.head) { delete std::exchange(pool.head, pool.head->next); }
+        }
+    };
+
+public:
+    static frame_pool& local() noexcept {
+        thread_local constinit frame_pool pool;
+        return pool;
+    }
+
+    _Block* get() {
+        if (!closed) { thread_local reaper r; (void)r; }
+        if (!head) { auto b = new _Block; b->pooled = true; return b; }
+        return std::exchange(head, head->next);
+    }
+
+    void put(_Block* b) noexcept {
+        if (closed) { delete b; return; }
+        b->next = std::exchange(head, b);
+    }
+};
+
+template <std::size_t Bytes>
+constexpr frame_buffer<Bytes>* find_frame_buffer() noexcept { return nullptr; }
+
+template <std::size_t Bytes, typename Arg, typename... Args>
+constexpr frame_buffer<Bytes>* find_frame_buffer(Arg& arg, Args&... args) noexcept {
+    if constexpr (std::is_same_v<std::remove_cv_t<Arg>, frame_buffer<Bytes>>) {
+        static_assert(!std::is_const_v<Arg>,
+            "a frame_buffer holding a frame must be passed by non-const reference");
+        return const_cast<frame_buffer<Bytes>*>(std::addressof(arg));
+    } else {
+        return find_frame_buffer<Bytes>(args...);
+    }
+}
+
+} // namespace _
+
+// `Args` are the parameter types of the coroutine, so that `operator new`
+// needs not be a template. GCC pairs a template `operator new` with the usual
+// `operator delete` as mismatched, and warns about every coroutine.
+template <typename T, std::size_t Bytes, frame_overflow Overflow, typename... Args>
+struct static_async_fn_promise: async_fn_promise<T> {
+    using _Block = frame_buffer<Bytes>;
+    using async_fn_promise<T>::async_fn_promise;
+
+    static void* operator new(std::size_t n, std::remove_reference_t<Args>&... args) {
+        if (n > Bytes) {
+            if constexpr (Overflow == frame_overflow::terminate) { std::terminate(); }
+            return ::operator new(n);
+        }
+        auto b = _::find_frame_buffer<Bytes>(args...);
+        if (!b) { b = _::frame_pool<Bytes>::local().get(); }
+        else if (b->busy) { std::terminate(); }
+        b->busy = true;
+        return b->data;
+    }
+
+    static void operator delete(void* ptr, std::size_t n) noexcept {
+        if (n > Bytes) { ::operator delete(ptr); return; }
+        // `data` is the first member, so the frame is at the block address
+        auto b = static_cast<_Block*>(ptr);
+        b->busy = false;
+        if (b->pooled) { _::frame_pool<Bytes>::local().put(b); }
+    }
+};
+
+/**
+ * @brief An `async_fn` whose frame is placed in a fixed-size block.
+ *
+ * When one of the arguments is a `frame_buffer<Bytes>&`, the frame is placed
+ * in it, otherwise it is taken from a thread local pool of blocks, which is
+ * refilled when frames are destroyed. A frame larger than `Bytes` is handled
+ * as told by `Overflow`. Since frame sizes are only known to the compiler,
+ * `Bytes` should be verified for each target with `frame_overflow::terminate`.
+ *
+ * Once the pool is warm, calling this allocates nothing. A block freed on
+ * another thread joins the pool of that thread, and one freed after that
+ * thread started exiting is deleted. The block passed as an argument must not
+ * be `const`.
+ */
+template <typename T, std::size_t Bytes, frame_overflow Overflow = frame_overflow::heap>
+class static_async_fn : public async_fn<T> {
+public:
+    template <typename... Args>
+    static_async_fn(static_async_fn_promise<T, Bytes, Overflow, Args...>& p) : async_fn<T>(p) {}
+};
+
+} // namespace coutils::crt
+
+template <typename T, std::size_t Bytes, coutils::crt::frame_overflow Overflow, typename... Args>
+struct std::coroutine_traits<coutils::crt::static_async_fn<T, Bytes, Overflow>, Args...> {
+    using promise_type = coutils::promise_bridge<
+        coutils::crt::static_async_fn<T, Bytes, Overflow>,
+        coutils::crt::static_async_fn_promise<T, Bytes, Overflow, Args...>
+    >;
+};
+
+#endif // __COUTILS_CRT_STATIC_ASYNC_FN__
@@ -8,6 +8,9 @@
 #include "../value_wrapper.hpp"
 #include "../utility.hpp"
 #include "../traits.hpp"
+#ifdef COUTILS_FRAME_TELEMETRY
+#include "./frame_telemetry.hpp"
+#endif
 
 namespace coutils::crt {
 
@@ -30,6 +33,23 @@ public:
         { return promise.get().yield_resume(); }
 };
 
+/**
+ * @brief Awaits an awaiter lvalue through a pointer to it.
+ *
+ * GCC 12 copies an awaiter returned by reference from `await_transform`,
+ * which does not compile for move-only awaiters like stream iterators, and
+ * would await the copy instead of the original otherwise.
+ */
+template <typename A>
+class awaiter_ref {
+    A* ptr;
+public:
+    awaiter_ref(A& awaiter) noexcept : ptr(std::addressof(awaiter)) {}
+    decltype(auto) await_ready() { return ptr->await_ready(); }
+    decltype(auto) await_suspend(auto hd) { return ptr->await_suspend(hd); }
+    decltype(auto) await_resume() { return ptr->await_resume(); }
+};
+
 /**
  * @brief An empty class tag.
  * 
@@ -148,8 +168,8 @@ class zygote_promise:
 
 public:
     static_assert(
-        non_value<R> || reconstructible<R>,
-        "return type should be non_value or reconstructible"
+        non_value<R> || std::is_destructible_v<R>,
+        "return type should be non_value or destructible"
     );
 
     static_assert(
@@ -169,6 +189,13 @@ public:
 
     wrap_variant<void, Y, S, R, std::exception_ptr> data;
 
+#ifdef COUTILS_FRAME_TELEMETRY
+    static void* operator new(std::size_t n)
+        { return _::frame_stats::of<D>().allocate(n); }
+    static void operator delete(void* ptr, std::size_t n) noexcept
+        { _::frame_stats::deallocate(ptr, n); }
+#endif
+
     decltype(auto) status() const noexcept
         { return static_cast<promise_state>(data.index()); }
 
@@ -178,8 +205,11 @@ public:
     }
 
     template <traits::awaitable T>
-    constexpr decltype(auto) await_transform(T&& obj)
-        { return COUTILS_FWD(obj); }
+    constexpr decltype(auto) await_transform(T&& obj) {
+        if constexpr (std::is_lvalue_reference_v<T> && !traits::awaiter_convertible<T>)
+            { return awaiter_ref<std::remove_reference_t<T>>(obj); }
+        else { return COUTILS_FWD(obj); }
+    }
 
     decltype(auto) initial_suspend() noexcept
         { return std::suspend_always{}; }
@@ -288,7 +318,10 @@ public:
         if constexpr (non_value<R>) {
             auto&& r = p.get_returned();
             return static_cast<R>(r);
-        } else if constexpr (reconstructible<R>) {
+        } else {
+            static_assert(reconstructible<R>,
+                "non-reconstructible result cannot be moved out of promise"
+            );
             R r = std::move(p.get_returned());
             return r;
         }
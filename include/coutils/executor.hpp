@@ -0,0 +1,157 @@
+#pragma once
+#ifndef __COUTILS_EXECUTOR__
+#define __COUTILS_EXECUTOR__
+
+#include <chrono>
+#include <memory>
+#include <utility>
+#include <concepts>
+#include <coroutine>
+#include <type_traits>
+#include "coutils/traits.hpp"
+
+namespace coutils {
+
+/**
+ * @brief Checks if `E` can run coroutines posted to it.
+ *
+ * `post` queues a handle to be resumed on the executor, and
+ * `running_in_this_thread` tells whether calling thread belongs to it.
+ */
+template <typename E>
+concept executor = requires (E& e, const E& ce, std::coroutine_handle<> h) {
+    e.post(h);
+    { ce.running_in_this_thread() } -> std::convertible_to<bool>;
+};
+
+/**
+ * @brief A non-owning type erased reference to an executor.
+ */
+class executor_ref {
+    void* self = nullptr;
+    void (*_post)(void*, std::coroutine_handle<>) = nullptr;
+    bool (*_here)(const void*) = nullptr;
+
+public:
+    executor_ref() noexcept = default;
+
+    template <executor E> requires (!std::is_same_v<std::remove_cv_t<E>, executor_ref>)
+    executor_ref(E& e) noexcept :
+        self(std::addressof(e)),
+        _post([](void* s, std::coroutine_handle<> h) { static_cast<E*>(s)->post(h); }),
+        _here([](const void* s) -> bool { return static_cast<const E*>(s)->running_in_this_thread(); }) {}
+
+    explicit operator bool() const noexcept { return self != nullptr; }
+    const void* address() const noexcept { return self; }
+    bool operator==(const executor_ref& other) const noexcept { return self == other.self; }
+
+    void post(std::coroutine_handle<> h) const { _post(self, h); }
+    bool running_in_this_thread() const { return _here(self); }
+};
+
+/**
+ * @brief Scheduling attributes of a coroutine.
+ *
+ * Executors ordering their run queue (like `priority_scheduler`) read it,
+ * others ignore it. `async_fn` callees inherit it from their caller. Larger
+ * `priority` is more urgent, and `deadline` overrides `priority` when set.
+ */
+struct schedule_hint {
+    using clock = std::chrono::steady_clock;
+    int priority = 0;
+    clock::time_point deadline = clock::time_point::max();
+
+    bool has_deadline() const noexcept { return deadline != clock::time_point::max(); }
+};
+
+namespace _ {
+
+inline thread_local executor_ref current_executor = {};
+// hint of the coroutine being resumed by an executor reading hints
+inline thread_local schedule_hint current_hint = {};
+
+/**
+ * @brief Makes `ex` the current executor of this thread during its lifetime.
+ *
+ * Executors use this around code they run.
+ */
+class executor_scope {
+    executor_ref previous;
+
+public:
+    explicit executor_scope(executor_ref ex) noexcept :
+        previous(std::exchange(current_executor, ex)) {}
+    ~executor_scope() { current_executor = previous; }
+
+    executor_scope(const executor_scope&) = delete;
+    executor_scope& operator=(const executor_scope&) = delete;
+};
+
+/**
+ * @brief Resumes `h` on `ex`, inline (through the trampoline of calling
+ *        thread) when already there or `ex` is null.
+ */
+inline void dispatch(executor_ref ex, std::coroutine_handle<> h) {
+    if (ex && !ex.running_in_this_thread()) { ex.post(h); }
+    else { ops::resume_trampolined(h); }
+}
+
+/**
+ * @brief An awaitable posting the awaiting coroutine to `ex`, even when `ex`
+ *        runs calling thread. Does not suspend when `ex` is null.
+ */
+struct post_to {
+    executor_ref ex;
+    bool await_ready() const noexcept { return !ex; }
+    void await_suspend(std::coroutine_handle<> h) const { ex.post(h); }
+    constexpr void await_resume() const noexcept {}
+};
+
+} // namespace _
+
+/**
+ * @brief Gets the executor running calling thread, null if there is none.
+ */
+inline executor_ref current_executor() noexcept { return _::current_executor; }
+
+/**
+ * @brief An awaitable that transfers control to another handle on an
+ *        executor.
+ *
+ * Like `transfer_to_handle`, but when `ex` is not null and does not run
+ * calling thread, the handle is posted to `ex` instead. Used in
+ * `final_suspend`, so if posting throws (e.g. a queue failing to allocate),
+ * the handle is resumed inline on calling thread instead.
+ */
+struct transfer_on_executor {
+    std::coroutine_handle<> other;
+    executor_ref ex;
+    bool await_ready() const noexcept { return other.address() == nullptr; }
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<>) const noexcept {
+        try {
+            if (ex && !ex.running_in_this_thread())
+                { ex.post(other); return std::noop_coroutine(); }
+        } catch (...) {}
+        return other;
+    }
+    constexpr void await_resume() const noexcept {}
+};
+
+/**
+ * @brief An awaitable that moves the awaiting coroutine to `ex`.
+ *
+ * Does not suspend when `ex` already runs calling thread.
+ */
+class resume_on {
+    executor_ref ex;
+
+public:
+    resume_on(executor_ref ex) noexcept : ex(ex) {}
+    bool await_ready() const { return !ex || ex.running_in_this_thread(); }
+    void await_suspend(std::coroutine_handle<> h) const { ex.post(h); }
+    constexpr void await_resume() const noexcept {}
+};
+
+} // namespace coutils
+
+#endif // __COUTILS_EXECUTOR__
@@ -0,0 +1,232 @@
+#pragma once
+#ifndef __COUTILS_HEDGED__
+#define __COUTILS_HEDGED__
+
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <cstdint>
+#include <utility>
+#include <optional>
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include <stop_token>
+#include <type_traits>
+#include "coutils/traits.hpp"
+#include "coutils/utility.hpp"
+#include "coutils/executor.hpp"
+#include "coutils/timer.hpp"
+#include "coutils/crt/agent.hpp"
+#include "coutils/crt/async_fn.hpp"
+
+namespace coutils {
+
+/**
+ * @brief Counters of `hedged` calls sharing it.
+ */
+struct hedge_stats {
+    std::atomic<std::uint64_t> calls = 0;
+    // attempts launched after the first one
+    std::atomic<std::uint64_t> hedges = 0;
+    // calls won by an attempt other than the first one
+    std::atomic<std::uint64_t> hedge_wins = 0;
+};
+
+namespace _ {
+
+template <typename F>
+decltype(auto) call_attempt(F& factory, std::stop_token token) {
+    if constexpr (std::is_invocable_v<F&, std::stop_token>) { return std::invoke(factory, std::move(token)); }
+    else { return std::invoke(factory); }
+}
+
+template <typename F>
+using hedge_result_t = traits::co_await_t<decltype(call_attempt(std::declval<F&>(), std::stop_token()))>;
+
+template <typename T, typename F>
+class hedge_state : public std::enable_shared_from_this<hedge_state<T, F>> {
+    using _Value = std::conditional_t<std::is_void_v<T>, std::monostate, T>;
+
+    F factory;
+    timer_queue::clock::duration delay;
+    std::size_t max_attempts;
+    hedge_stats* stats;
+    timer_queue& timer;
+    std::stop_source stop;
+
+    default_lock lock;
+    std::size_t launched = 0, failed = 0;
+    bool done = false;
+    std::optional<_Value> result;
+    std::exception_ptr error;
+    std::coroutine_handle<> waiter;
+    executor_ref ex;
+    // the pending hedge timer, if any
+    std::optional<timer_queue::timer_id> armed;
+    std::coroutine_handle<> ticker;
+
+    static crt::agent attempt(std::shared_ptr<hedge_state> self, std::size_t index) noexcept {
+        try {
+            if constexpr (std::is_void_v<T>) {
+                co_await call_attempt(self->factory, self->stop.get_token());
+                self->succeed(index, std::monostate{});
+            } else {
+                auto value = co_await call_attempt(self->factory, self->stop.get_token());
+                self->succeed(index, std::move(value));
+            }
+        } catch (...) { self->fail(std::current_exception()); }
+    }
+
+    struct wait_delay {
+        hedge_state& self;
+        constexpr bool await_ready() const noexcept { return false; }
+        bool await_suspend(std::coroutine_handle<> h) {
+            auto guard = std::lock_guard(self.lock);
+            if (self.done) { return false; }
+            self.ticker = h;
+            self.armed = self.timer.post_at(timer_queue::clock::now() + self.delay, h);
+            return true;
+        }
+        constexpr void await_resume() const noexcept {}
+    };
+
+    /**
+     * @brief Launches another attempt every `delay` until there is a result
+     *        or no attempt left.
+     */
+    static crt::agent hedge_timer(std::shared_ptr<hedge_state> self) noexcept {
+        while (true) {
+            co_await wait_delay{*self};
+            std::size_t index;
+            {
+                auto guard = std::lock_guard(self->lock);
+                self->armed.reset();
+                if (self->done || self->launched >= self->max_attempts) { co_return; }
+                index = self->launched++;
+            }
+            if (self->stats) { self->stats->hedges.fetch_add(1, std::memory_order::relaxed); }
+            // attempts should not run on the timer thread
+            _::dispatch(self->ex, attempt(self, index).handle);
+        }
+    }
+
+    // called with `lock` held, after `done` is set
+    void disarm() {
+        if (armed && timer.cancel(*armed)) {
+            // never resumed, so its frame is dropped here
+            std::exchange(ticker, nullptr).destroy();
+        }
+        armed.reset();
+    }
+
+    void succeed(std::size_t index, _Value&& value) {
+        std::coroutine_handle<> w;
+        {
+            auto guard = std::lock_guard(lock);
+            if (done) { return; }
+            done = true;
+            result.emplace(std::move(value));
+            disarm();
+            w = waiter;
+        }
+        if (stats && index > 0) { stats->hedge_wins.fetch_add(1, std::memory_order::relaxed); }
+        stop.request_stop();
+        _::dispatch(ex, w);
+    }
+
+    void fail(std::exception_ptr e) {
+        std::coroutine_handle<> w;
+        std::size_t index = 0;
+        {
+            auto guard = std::lock_guard(lock);
+            if (done) { return; }
+            error = std::move(e);
+            if (++failed < launched) { return; }
+            // all launched attempts failed, so one more is launched now
+            // instead of after the delay
+            if (launched < max_attempts) {
+                index = launched++;
+            } else {
+                done = true;
+                disarm();
+                w = waiter;
+            }
+        }
+        if (w) { _::dispatch(ex, w); return; }
+        if (stats) { stats->hedges.fetch_add(1, std::memory_order::relaxed); }
+        _::dispatch(ex, attempt(this->shared_from_this(), index).handle);
+    }
+
+public:
+    hedge_state(F&& factory, timer_queue::clock::duration delay, std::size_t max_attempts,
+                hedge_stats* stats, timer_queue& timer):
+        factory(std::move(factory)), delay(delay),
+        max_attempts(max_attempts ? max_attempts : 1), stats(stats), timer(timer) {}
+
+    class awaiter {
+        std::shared_ptr<hedge_state> state;
+
+    public:
+        awaiter(std::shared_ptr<hedge_state> state) : state(std::move(state)) {}
+
+        constexpr bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> h) {
+            // `this` may be gone once the first attempt is launched
+            auto self = state;
+            {
+                auto guard = std::lock_guard(self->lock);
+                self->waiter = h;
+                self->ex = coutils::current_executor();
+                self->launched = 1;
+            }
+            if (self->stats) { self->stats->calls.fetch_add(1, std::memory_order::relaxed); }
+            if (self->max_attempts > 1) { hedge_timer(self).handle.resume(); }
+            attempt(self, 0).handle.resume();
+        }
+        T await_resume() {
+            if (!state->result) { std::rethrow_exception(state->error); }
+            if constexpr (!std::is_void_v<T>) { return std::move(*state->result); }
+        }
+    };
+};
+
+} // namespace _
+
+/**
+ * @brief Calls `factory` for an attempt, and again every `delay` until an
+ *        attempt succeeds, making at most `max_attempts` attempts, and gets
+ *        the result of the first successful one.
+ *
+ * For idempotent operations with a long tail of latency, `delay` is usually
+ * around the 95th percentile of it, so that few calls are hedged. `factory`
+ * should give an awaitable like `async_fn`, and may take a `std::stop_token`,
+ * which is stopped once an attempt succeeds, so that slower attempts can give
+ * up. Otherwise their results are discarded. An attempt failing while no
+ * other runs makes the next one launch at once. When all attempts fail, the
+ * last exception is rethrown.
+ *
+ * The first attempt runs on calling thread, and later ones are posted to the
+ * executor running the caller (or run on the timer thread without one), so
+ * `factory` may be called concurrently. Hedges are timed by `default_timer()`.
+ * `stats`, when given, counts calls, hedges and hedges that won.
+ *
+ * A call allocates its state shared by attempts, a frame per attempt, and a
+ * frame and a timer for hedging when `max_attempts` is more than 1. Attempts
+ * left running keep the state, and `factory` in it, alive until they finish.
+ */
+template <typename F>
+auto hedged(F factory, timer_queue::clock::duration delay, std::size_t max_attempts = 2, hedge_stats* stats = nullptr)
+    -> crt::async_fn<_::hedge_result_t<F>>
+{
+    using _State = _::hedge_state<_::hedge_result_t<F>, F>;
+    static_assert(std::is_void_v<_::hedge_result_t<F>> || std::is_object_v<_::hedge_result_t<F>>,
+        "hedged attempts should result in an object or nothing");
+    auto state = std::make_shared<_State>(std::move(factory), delay, max_attempts, stats, default_timer());
+    co_return co_await typename _State::awaiter(std::move(state));
+}
+
+} // namespace coutils
+
+#endif // __COUTILS_HEDGED__
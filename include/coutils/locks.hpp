@@ -0,0 +1,324 @@
+#pragma once
+#ifndef __COUTILS_LOCKS__
+#define __COUTILS_LOCKS__
+
+#include <atomic>
+#include <thread>
+#include <cstdint>
+
+namespace coutils {
+
+namespace _ {
+
+/**
+ * @brief Hints the CPU that calling thread is spinning.
+ */
+inline void cpu_relax() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+    asm volatile("yield");
+#else
+    std::this_thread::yield();
+#endif
+}
+
+/**
+ * @brief Gets `rounds` on multicore machines, 0 on one core, where a thread
+ *        waiting for another one only delays it by spinning.
+ */
+inline unsigned spin_limit(unsigned rounds) noexcept {
+    static const bool single_core = std::thread::hardware_concurrency() == 1;
+    return single_core ? 0 : rounds;
+}
+
+} // namespace _
+
+/*
+ * Following locks have the same interface as `light_lock` (`lock`, `unlock`
+ * and `try_lock`), so any of them can be used where `light_lock` is, including
+ * as `COUTILS_DEFAULT_LOCK`. They spin for a while before parking on
+ * `std::atomic::wait`, so short critical sections are handed off without a
+ * futex call. Which one is fastest depends on the machine and the load, see
+ * `examples/lock_bench.cpp`.
+ */
+
+/**
+ * @brief A lock spinning with exponential backoff before parking.
+ *
+ * Unlock only wakes a parked thread when there is one.
+ */
+class adaptive_lock {
+    using enum std::memory_order;
+    static constexpr std::uint32_t UNLOCKED = 0, LOCKED = 1, CONTENDED = 2;
+    static constexpr unsigned max_backoff = 64, spin_rounds = 8;
+
+    std::atomic<std::uint32_t> state = UNLOCKED;
+
+public:
+    explicit adaptive_lock() {}
+
+    bool try_lock() noexcept {
+        auto expected = UNLOCKED;
+        return state.compare_exchange_strong(expected, LOCKED, acquire, relaxed);
+    }
+
+    void lock() noexcept {
+        if (try_lock()) { return; }
+        unsigned backoff = 1;
+        for (unsigned round = 0; round < spin_rounds; ++round) {
+            for (unsigned i = 0; i < backoff; ++i) { _::cpu_relax(); }
+            if (state.load(relaxed) == UNLOCKED && try_lock()) { return; }
+            if (backoff < max_backoff) { backoff *= 2; }
+        }
+        // mark contended, so that the holder wakes us on unlock
+        while (state.exchange(CONTENDED, acquire) != UNLOCKED)
+            { state.wait(CONTENDED, relaxed); }
+    }
+
+    void unlock() noexcept {
+        if (state.exchange(UNLOCKED, release) == CONTENDED) { state.notify_one(); }
+    }
+};
+
+/**
+ * @brief A FIFO lock handing out tickets.
+ *
+ * Waiters back off in proportion to their distance from the head of the
+ * queue, and park after spinning for a while on one of a few wait slots
+ * picked by their ticket, so that `unlock` only wakes the slot of the next
+ * ticket.
+ */
+class ticket_lock {
+    using enum std::memory_order;
+    static constexpr unsigned spin_rounds = 64;
+    static constexpr std::uint32_t slot_count = 16;
+
+    alignas(64) std::atomic<std::uint32_t> next = 0;
+    alignas(64) std::atomic<std::uint32_t> serving = 0;
+    std::atomic<std::uint32_t> sleepers = 0;
+    // bumped to wake tickets parked on them
+    std::atomic<std::uint32_t> slots[slot_count] = {};
+
+public:
+    explicit ticket_lock() {}
+
+    bool try_lock() noexcept {
+        auto current = serving.load(relaxed);
+        auto expected = current;
+        return next.compare_exchange_strong(expected, current + 1, acquire, relaxed);
+    }
+
+    void lock() noexcept {
+        auto ticket = next.fetch_add(1, relaxed);
+        auto current = serving.load(acquire);
+        auto& slot = slots[ticket % slot_count];
+        auto spins = _::spin_limit(spin_rounds);
+        for (unsigned round = 0; current != ticket; ++round) {
+            if (round < spins) {
+                for (auto i = ticket - current; i > 0; --i) { _::cpu_relax(); }
+                current = serving.load(acquire);
+            } else {
+                sleepers.fetch_add(1, seq_cst);
+                auto seen = slot.load(seq_cst);
+                if (serving.load(seq_cst) != ticket) { slot.wait(seen, seq_cst); }
+                sleepers.fetch_sub(1, relaxed);
+                current = serving.load(acquire);
+            }
+        }
+    }
+
+    void unlock() noexcept {
+        auto ticket = serving.fetch_add(1, seq_cst) + 1;
+        if (sleepers.load(seq_cst)) {
+            // only tickets `slot_count` apart share a slot
+            auto& slot = slots[ticket % slot_count];
+            slot.fetch_add(1, seq_cst);
+            slot.notify_all();
+        }
+    }
+};
+
+/**
+ * @brief An MCS queue lock, where every waiter spins on its own node.
+ *
+ * Waiters only touch their own cache line while spinning, and the lock is
+ * handed off in FIFO order. This is the variant where the lock holds a node
+ * standing in for the holder, so a waiter's node lives on its stack only
+ * while it waits, nothing is allocated and `unlock` may be called on any
+ * thread. Waiters that spun for long park on their own nodes, and `unlock`
+ * only wakes the successor.
+ */
+class mcs_lock {
+    using enum std::memory_order;
+    static constexpr unsigned spin_rounds = 256;
+    // A waiting node goes from `WAITING` to `PARKED` by its waiter, and to
+    // `GRANTED` by `unlock`, through `WAKING` when parked. A parked waiter
+    // keeps its node until `GRANTED`, the last store of `unlock` to it.
+    static constexpr std::uint32_t GRANTED = 0, WAITING = 1, PARKED = 2, WAKING = 3;
+
+    struct alignas(64) node {
+        std::atomic<node*> next = nullptr;
+        std::atomic<std::uint32_t> state = GRANTED;
+    };
+
+    std::atomic<node*> tail = nullptr;
+    // stands in for the node of the holder, its successor is linked here
+    node head;
+
+    // waits for another thread in the middle of a few stores
+    static void pause(unsigned& round) noexcept {
+        if (round++ < _::spin_limit(spin_rounds)) { _::cpu_relax(); }
+        else { std::this_thread::yield(); }
+    }
+
+    static void wait_turn(node& n) noexcept {
+        unsigned round = 0, spins = _::spin_limit(spin_rounds);
+        for (auto s = n.state.load(acquire); s != GRANTED; s = n.state.load(acquire)) {
+            if (s == PARKED) { n.state.wait(PARKED, acquire); }
+            else if (s == WAKING || round < spins) { pause(round); }
+            else { n.state.compare_exchange_strong(s, PARKED, relaxed, relaxed); }
+        }
+    }
+
+public:
+    explicit mcs_lock() {}
+
+    bool try_lock() noexcept {
+        node* expected = nullptr;
+        return tail.compare_exchange_strong(expected, &head, acquire, relaxed);
+    }
+
+    void lock() noexcept {
+        while (true) {
+            auto prev = tail.load(relaxed);
+            if (!prev) {
+                if (tail.compare_exchange_weak(prev, &head, acquire, relaxed)) { return; }
+                continue;
+            }
+            node n;
+            n.state.store(WAITING, relaxed);
+            if (!tail.compare_exchange_weak(prev, &n, acq_rel, relaxed)) { continue; }
+            prev->next.store(&n, release);
+            wait_turn(n);
+            // move the successor to `head` before `n` goes away
+            auto next = n.next.load(acquire);
+            if (!next) {
+                head.next.store(nullptr, relaxed);
+                auto expected = &n;
+                if (tail.compare_exchange_strong(expected, &head, acq_rel, relaxed)) { return; }
+                // a successor is linking itself to `n`
+                for (unsigned round = 0; !(next = n.next.load(acquire)); ) { pause(round); }
+            }
+            head.next.store(next, relaxed);
+            return;
+        }
+    }
+
+    void unlock() noexcept {
+        auto next = head.next.load(acquire);
+        if (!next) {
+            auto expected = &head;
+            if (tail.compare_exchange_strong(expected, nullptr, release, relaxed)) { return; }
+            // a successor is linking itself to `head`
+            for (unsigned round = 0; !(next = head.next.load(acquire)); ) { pause(round); }
+        }
+        // `next` may be gone once it sees `GRANTED`
+        auto expected = WAITING;
+        if (next->state.compare_exchange_strong(expected, GRANTED, release, relaxed)) { return; }
+        next->state.store(WAKING, relaxed);
+        next->state.notify_one();
+        next->state.store(GRANTED, release);
+    }
+};
+
+/**
+ * @brief A writer-preferring reader-writer lock.
+ *
+ * Besides `lock`, `unlock` and `try_lock` for exclusive access, it has
+ * `lock_shared`, `unlock_shared` and `try_lock_shared` for shared access, so
+ * it also works with `std::shared_lock`. New readers wait while a writer is
+ * waiting.
+ */
+class rw_lock {
+    using enum std::memory_order;
+    static constexpr std::uint32_t WRITER = 1u << 31, PENDING = 1u << 30;
+    static constexpr std::uint32_t READERS = PENDING - 1;
+    static constexpr unsigned spin_rounds = 64;
+
+    std::atomic<std::uint32_t> state = 0;
+    std::atomic<std::uint32_t> sleepers = 0;
+
+    void pause(std::uint32_t seen, unsigned round) noexcept {
+        if (round < spin_rounds) { _::cpu_relax(); return; }
+        sleepers.fetch_add(1, seq_cst);
+        state.wait(seen, seq_cst);
+        sleepers.fetch_sub(1, relaxed);
+    }
+
+    void wake() noexcept {
+        if (sleepers.load(seq_cst)) { state.notify_all(); }
+    }
+
+public:
+    explicit rw_lock() {}
+
+    bool try_lock() noexcept {
+        auto s = state.load(relaxed);
+        while ((s & (WRITER | READERS)) == 0) {
+            if (state.compare_exchange_weak(s, WRITER, acquire, relaxed)) { return true; }
+        }
+        return false;
+    }
+
+    void lock() noexcept {
+        auto s = state.load(relaxed);
+        for (unsigned round = 0; ; ++round) {
+            if ((s & (WRITER | READERS)) == 0) {
+                // clears `PENDING`, other waiting writers set it again
+                if (state.compare_exchange_weak(s, WRITER, acquire, relaxed)) { return; }
+                continue;
+            }
+            if (!(s & PENDING)) {
+                if (!state.compare_exchange_weak(s, s | PENDING, relaxed, relaxed)) { continue; }
+                s |= PENDING;
+            }
+            pause(s, round);
+            s = state.load(relaxed);
+        }
+    }
+
+    void unlock() noexcept {
+        state.fetch_and(~WRITER, seq_cst);
+        wake();
+    }
+
+    bool try_lock_shared() noexcept {
+        auto s = state.load(relaxed);
+        while ((s & (WRITER | PENDING)) == 0) {
+            if (state.compare_exchange_weak(s, s + 1, acquire, relaxed)) { return true; }
+        }
+        return false;
+    }
+
+    void lock_shared() noexcept {
+        auto s = state.load(relaxed);
+        for (unsigned round = 0; ; ++round) {
+            if ((s & (WRITER | PENDING)) == 0) {
+                if (state.compare_exchange_weak(s, s + 1, acquire, relaxed)) { return; }
+                continue;
+            }
+            pause(s, round);
+            s = state.load(relaxed);
+        }
+    }
+
+    void unlock_shared() noexcept {
+        auto prev = state.fetch_sub(1, seq_cst);
+        if ((prev & READERS) == 1) { wake(); }
+    }
+};
+
+} // namespace coutils
+
+#endif // __COUTILS_LOCKS__
@@ -9,6 +9,7 @@
 #include "coutils/value_wrapper.hpp"
 #include "coutils/utility.hpp"
 #include "coutils/traits.hpp"
+#include "coutils/executor.hpp"
 #include "coutils/crt/agent.hpp"
 
 namespace coutils {
@@ -23,6 +24,21 @@ private:
         awaitables(COUTILS_FWD(args)...),
         awaiters(ops::get_awaiter(static_cast<Ts&&>(std::get<Is>(awaitables)))...) {}
 
+    template <std::size_t... Is>
+    await_storage(std::index_sequence<Is...>, await_storage&& other):
+        awaitables(std::move(other.awaitables)),
+        awaiters(moved_awaiter<Is>(other)...) {}
+
+    // awaiters referring to awaitables (or their members) are obtained again
+    // from moved awaitables, other awaiters are moved
+    template <std::size_t I>
+    decltype(auto) moved_awaiter(await_storage& other) {
+        using _Awaitable = typack_index_t<I, Ts...>;
+        if constexpr (std::is_reference_v<traits::awaiter_cvt_t<_Awaitable>>)
+            { return ops::get_awaiter(static_cast<_Awaitable&&>(std::get<I>(awaitables))); }
+        else { return std::get<I>(std::move(other.awaiters)); }
+    }
+
 public:
     wrap_tuple<Ts...> awaitables;
     wrap_tuple<traits::awaiter_cvt_t<Ts>...> awaiters;
@@ -30,6 +46,16 @@ public:
     await_storage(auto&&... args) requires (sizeof...(args) == sizeof...(Ts)) :
         await_storage(std::index_sequence_for<Ts...>{}, COUTILS_FWD(args)...) {}
 
+    /**
+     * @brief Moves a storage whose awaitables are not started yet.
+     *
+     * Compilers may move an awaitable after it is constructed (GCC 12 does
+     * when awaiting a temporary), which must not leave awaiters referring to
+     * the moved-from awaitables.
+     */
+    await_storage(await_storage&& other):
+        await_storage(std::index_sequence_for<Ts...>{}, std::move(other)) {}
+
     using any_result = wrap_variant<traits::co_await_t<Ts>...>;
     using all_result = wrap_tuple<traits::co_await_t<Ts>...>;
 
@@ -41,6 +67,16 @@ public:
         } (std::index_sequence_for<Ts...>{});
     }
 
+    void launch_one(std::size_t idx, std::coroutine_handle<> handle) {
+        if constexpr (sizeof...(Ts) != 0) {
+            visit_index<sizeof...(Ts)>(idx,
+                COUTILS_VISITOR(I) {
+                    ops::await_launch(std::get<I>(awaiters), handle);
+                }
+            );
+        }
+    }
+
     any_result get_any(std::size_t idx) {
         return visit_index<sizeof...(Ts)>(idx,
             COUTILS_VISITOR(I) {
@@ -71,7 +107,8 @@ struct as_completed_shim {
 
     struct controller {
         std::coroutine_handle<> caller = nullptr;
-        light_lock lock;
+        executor_ref home = {};
+        default_lock lock;
         std::atomic<std::size_t> finished = 0, consumed = 0;
         std::span<std::size_t> order;
 
@@ -98,7 +135,7 @@ struct as_completed_shim {
                 // here is actually a pop operation of a SPSC queue
                 auto v_consumed = consumed.load(relaxed);
                 auto v_finished = finished.load(acquire);
-                caller = ch;
+                caller = ch; home = coutils::current_executor();
                 should_suspend = v_consumed + 1 == v_finished && v_consumed + 1 < order.size();
                 consumed.store(v_consumed + 1, release);
             }
@@ -107,7 +144,7 @@ struct as_completed_shim {
     };
 
     static crt::agent shim(std::size_t id, std::shared_ptr<controller> control) noexcept {
-        if (control->finish(id)) { control->caller.resume(); }
+        if (control->finish(id)) { _::dispatch(control->home, control->caller); }
         co_return;
     }
 };
@@ -131,7 +168,8 @@ struct as_completed_shim {
  * First, the awaitables will be started serially on the same thread as caller,
  * then, as the iterator increments, the caller may be resumed on different
  * threads. After iteration ends, the caller may be resumed any one of given
- * awaitables.
+ * awaitables. When the caller runs on an executor (see `current_executor()`),
+ * it is resumed on that executor instead.
  * 
  * If awaitables are not all consumed when this is destructed, the ones left
  * will have their result dropped.
@@ -164,6 +202,7 @@ class as_completed : private _::as_completed_shim {
         if (control.use_count() == 0) {
             control = std::make_shared<controller>(order);
             control->caller = ch;
+            control->home = current_executor();
             storage.launch([&](size_t idx) {
                 return shim(idx, control).handle;
             });
@@ -174,7 +213,7 @@ class as_completed : private _::as_completed_shim {
 
     decltype(auto) get_result() {
         auto consumed = control->consumed.load(relaxed);
-        return storage.get_any(consumed);
+        return storage.get_any(order[consumed]);
     }
 
     void drop_left() {
@@ -232,12 +271,13 @@ namespace _ {
 struct all_completed_shim {
     struct controller {
         std::coroutine_handle<> caller;
+        executor_ref home;
         std::atomic<std::size_t> count;
     };
 
     static crt::agent shim(size_t id, controller& control) noexcept {
         // When we are the last one, resume parent.
-        if (--control.count == 0) { control.caller.resume(); }
+        if (--control.count == 0) { _::dispatch(control.home, control.caller); }
         co_return;
     }
 };
@@ -260,7 +300,9 @@ struct all_completed_shim {
  * 
  * First, the awaitables will be started serially on the same thread as caller,
  * then, the caller will be resumed when all awaitables are fulfilled. The
- * caller may be resumed by any one of given awaitables.
+ * caller may be resumed by any one of given awaitables, or posted back to its
+ * executor when it runs on one (see `current_executor()`). To start the
+ * awaitables in parallel, use `all_completed_on`.
  * 
  * This class will cause N + 1 heap allocations (N for N shim coroutines and 1
  * for a control block) when awaited.
@@ -281,11 +323,13 @@ public:
 
     constexpr static std::size_t size = sizeof...(Ts);
 
-    constexpr bool await_ready() const noexcept { return false; }
+    // nothing would resume the caller without awaitables
+    constexpr bool await_ready() const noexcept { return size == 0; }
 
     decltype(auto) await_suspend(std::coroutine_handle<> ch) {
         control = std::make_unique<controller>();
         control->caller = ch;
+        control->home = current_executor();
         control->count = size;
         storage.launch([&](size_t idx) {
             return shim(idx, *control).handle;
@@ -300,6 +344,73 @@ public:
 template <traits::awaitable... Ts>
 all_completed(Ts&&...) -> all_completed<Ts...>;
 
+/**
+ * @brief Like `all_completed`, but starts the awaitables on an executor in
+ *        parallel.
+ * 
+ * The range of awaitables is split recursively by helper coroutines posted
+ * to `ex`, each of them posting the upper half of its range before starting
+ * the first awaitable of it, so that awaitables that do heavy work when
+ * started (e.g. `async_fn` computing synchronously) run on different workers.
+ * Wall time of such awaitables is then about the longest of them instead of
+ * their sum.
+ * 
+ * The caller will be resumed when all awaitables are fulfilled, posted back
+ * to its executor when it runs on one (see `current_executor()`).
+ * 
+ * This class will cause 2N + 1 heap allocations (N for N shim coroutines, N
+ * for N splitting coroutines and 1 for a control block) when awaited.
+ */
+template <traits::awaitable... Ts>
+class all_completed_on : private _::all_completed_shim {
+    using _::all_completed_shim::shim;
+    using _::all_completed_shim::controller;
+
+    using _Self = all_completed_on<Ts...>;
+    using _Storage = _::await_storage<Ts...>;
+
+    executor_ref ex;
+    _Storage storage;
+    std::unique_ptr<controller> control;
+
+    static crt::agent split(_Self& self, std::size_t lo, std::size_t hi) noexcept {
+        while (hi - lo > 1) {
+            auto mid = lo + (hi - lo) / 2;
+            self.ex.post(split(self, mid, hi).handle);
+            hi = mid;
+        }
+        // `self` may be gone once the last awaitable is started
+        self.storage.launch_one(lo, shim(lo, *self.control).handle);
+        co_return;
+    }
+
+public:
+    // the constraint keeps the implicit deduction guide from deducing an
+    // empty `Ts` when `ex` is an `executor_ref`
+    all_completed_on(executor_ref ex, auto&&... args) requires (sizeof...(args) == sizeof...(Ts)):
+        ex(ex), storage(COUTILS_FWD(args)...) {}
+
+    constexpr static std::size_t size = sizeof...(Ts);
+
+    // nothing would resume the caller without awaitables
+    constexpr bool await_ready() const noexcept { return size == 0; }
+
+    void await_suspend(std::coroutine_handle<> ch) {
+        control = std::make_unique<controller>();
+        control->caller = ch;
+        control->home = current_executor();
+        control->count = size;
+        ex.post(split(*this, 0, size).handle);
+    }
+
+    _Storage::all_result await_resume() {
+        return storage.get_all();
+    }
+};
+
+template <executor E, traits::awaitable... Ts>
+all_completed_on(E&, Ts&&...) -> all_completed_on<Ts...>;
+
 #pragma endregion all_completed
 
 } // namespace coutils
@@ -0,0 +1,575 @@
+#pragma once
+#ifndef __COUTILS_MULTI_STREAM__
+#define __COUTILS_MULTI_STREAM__
+
+#include <mutex>
+#include <memory>
+#include <tuple>
+#include <vector>
+#include <optional>
+#include <functional>
+#include "coutils/value_wrapper.hpp"
+#include "coutils/utility.hpp"
+#include "coutils/traits.hpp"
+#include "coutils/crt/agent.hpp"
+#include "coutils/relay.hpp"
+#include "coutils/crt/async_generator.hpp"
+
+namespace coutils {
+
+namespace _ {
+
+/**
+ * @brief A bounded MPSC queue of completed producer indices with one waiter.
+ *
+ * Every producer is expected to have at most one completion pending at any
+ * time, so the ring never overflows when its capacity equals the number of
+ * producers. The ring is allocated once on construction.
+ *
+ * A producer may also retire without pushing anything, and the waiter is
+ * released once all producers are retired.
+ */
+class completion_queue {
+    default_lock lock;
+    std::unique_ptr<std::size_t[]> ring;
+    std::size_t capacity, head = 0, count = 0, live, wanted = 1;
+    std::coroutine_handle<> waiting = nullptr;
+
+    std::coroutine_handle<> take_waiting() {
+        if (!waiting || (count < wanted && live != 0)) { return nullptr; }
+        return std::exchange(waiting, nullptr);
+    }
+
+public:
+    explicit completion_queue(std::size_t capacity):
+        ring(std::make_unique<std::size_t[]>(capacity)),
+        capacity(capacity), live(capacity) {}
+
+    /**
+     * @brief Pushes a completion, returns the waiter that should be resumed.
+     */
+    std::coroutine_handle<> push(std::size_t id) {
+        auto guard = std::lock_guard(lock);
+        ring[(head + count++) % capacity] = id;
+        return take_waiting();
+    }
+
+    /**
+     * @brief Retires a producer, returns the waiter that should be resumed.
+     */
+    std::coroutine_handle<> retire() {
+        auto guard = std::lock_guard(lock);
+        --live;
+        return take_waiting();
+    }
+
+    /**
+     * @brief Registers `h` as waiter unless `n` completions are already
+     *        queued or all producers are retired.
+     *
+     * Returns whether `h` should suspend.
+     */
+    bool wait(std::coroutine_handle<> h, std::size_t n = 1) {
+        auto guard = std::lock_guard(lock);
+        if (count >= n || live == 0) { return false; }
+        wanted = n; waiting = h;
+        return true;
+    }
+
+    std::optional<std::size_t> pop() {
+        auto guard = std::lock_guard(lock);
+        if (count == 0) { return std::nullopt; }
+        auto id = ring[head];
+        head = (head + 1) % capacity; --count;
+        return id;
+    }
+};
+
+/**
+ * @brief Awaiter that suspends until `queue` has a completion.
+ */
+struct completion_wait {
+    completion_queue& queue;
+    constexpr bool await_ready() const noexcept { return false; }
+    bool await_suspend(std::coroutine_handle<> h) const
+        { return queue.wait(h); }
+    constexpr void await_resume() const noexcept {}
+};
+
+template <typename G>
+using stream_iterator = decltype(std::declval<G&>().begin());
+
+template <typename G>
+using stream_item = decltype(*std::declval<stream_iterator<G>&>());
+
+/**
+ * @brief A fixed set of source iterators of different types.
+ */
+template <typename... Gs>
+struct tuple_sources {
+    std::tuple<stream_iterator<Gs>...> its;
+
+    tuple_sources(Gs&&... gens) : its(gens.begin()...) {}
+
+    std::size_t size() const noexcept { return sizeof...(Gs); }
+
+    decltype(auto) visit(std::size_t idx, auto&& vis) {
+        return visit_index<sizeof...(Gs)>(idx,
+            COUTILS_VISITOR(I) { return vis(std::get<I>(its)); }
+        );
+    }
+};
+
+/**
+ * @brief A runtime-sized set of source iterators of the same type.
+ */
+template <typename G>
+struct vector_sources {
+    std::vector<stream_iterator<G>> its;
+
+    vector_sources(std::vector<G>&& gens) {
+        its.reserve(gens.size());
+        for (auto& gen : gens) { its.emplace_back(gen.begin()); }
+    }
+
+    std::size_t size() const noexcept { return its.size(); }
+
+    decltype(auto) visit(std::size_t idx, auto&& vis)
+        { return vis(its[idx]); }
+};
+
+} // namespace _
+
+#pragma region merge
+
+namespace _ {
+
+template <typename Sources>
+struct merge_control {
+    static constexpr std::size_t npos = std::size_t(-1);
+
+    Sources sources;
+    completion_queue queue;
+    relay_group<merge_control> relays;
+    std::size_t current = npos;
+
+    merge_control(Sources&& srcs):
+        sources(std::move(srcs)), queue(sources.size()),
+        relays(*this, sources.size()) {}
+
+    std::coroutine_handle<> complete(std::size_t id) {
+        bool returned = sources.visit(id,
+            [](auto& it) { return it == std::default_sentinel; });
+        return returned ? queue.retire() : queue.push(id);
+    }
+
+    void pull(std::size_t id) {
+        sources.visit(id, [&](auto& it) {
+            // a source that threw is already done
+            if (it.done()) { queue.retire(); }
+            else { ops::await_launch(it, relays[id]); }
+        });
+    }
+};
+
+} // namespace _
+
+/**
+ * @brief Pulls from multiple async generators concurrently and yields their
+ *        items in arrival order.
+ *
+ * Construct this with `coutils::merge`. All sources are started when the
+ * iterator is first awaited, and each source is resumed again only after its
+ * item has been consumed, because the item lives in the source's frame. Use
+ * `.index()` of the iterator to know which source the current item is from.
+ *
+ * An exception thrown by a source is rethrown by dereferencing the iterator.
+ *
+ * The caller may be resumed on the thread of any source. Destroying this
+ * while a source is still suspended on some pending operation is undefined.
+ *
+ * This class will cause N + 2 heap allocations (N relay coroutines, 1 for
+ * the completion ring and 1 for a control block) when first awaited, and
+ * none per item.
+ */
+template <typename Sources>
+class merge_stream {
+    using _Control = _::merge_control<Sources>;
+
+    std::optional<Sources> sources;
+    std::unique_ptr<_Control> control;
+
+    bool on_suspend(std::coroutine_handle<> ch) {
+        if (!control) {
+            control = std::make_unique<_Control>(std::move(*sources));
+            sources.reset();
+            for (std::size_t i = 0; i < control->sources.size(); ++i)
+                { control->pull(i); }
+        } else if (control->current != _Control::npos) {
+            control->pull(control->current);
+        }
+        return control->queue.wait(ch);
+    }
+
+    void on_resume()
+        { control->current = control->queue.pop().value_or(_Control::npos); }
+
+public:
+    merge_stream(Sources&& srcs) : sources(std::move(srcs)) {}
+
+    class iterator {
+        merge_stream* ptr;
+
+    public:
+        iterator(merge_stream& parent) : ptr(std::addressof(parent)) {}
+
+        iterator(const iterator&) = delete;
+        iterator(iterator&& other):
+            ptr(std::exchange(other.ptr, nullptr)) {}
+
+        std::size_t index() const { return ptr->control->current; }
+
+        bool operator==(std::default_sentinel_t) const
+            { return index() == _Control::npos; }
+        decltype(auto) operator*() {
+            return ptr->control->sources.visit(index(),
+                [](auto& it) -> decltype(auto) { return *it; });
+        }
+        iterator& operator++() & { return *this; }
+
+        constexpr bool await_ready() const noexcept { return false; }
+        bool await_suspend(std::coroutine_handle<> ch)
+            { return ptr->on_suspend(ch); }
+        void await_resume() { ptr->on_resume(); }
+    };
+
+    decltype(auto) begin() { return iterator(*this); }
+    decltype(auto) end() const { return std::default_sentinel; }
+};
+
+/**
+ * @brief Merges async generators yielding the same type.
+ */
+template <typename Y, typename... Ss>
+auto merge(crt::async_generator<Y, Ss>&&... gens) {
+    using _Sources = _::tuple_sources<crt::async_generator<Y, Ss>...>;
+    return merge_stream<_Sources>(_Sources(std::move(gens)...));
+}
+
+/**
+ * @brief Merges a runtime-sized set of async generators.
+ */
+template <typename Y, typename S>
+auto merge(std::vector<crt::async_generator<Y, S>> gens) {
+    using _Sources = _::vector_sources<crt::async_generator<Y, S>>;
+    return merge_stream<_Sources>(_Sources(std::move(gens)));
+}
+
+#pragma endregion merge
+
+#pragma region zip
+
+namespace _ {
+
+template <typename Sources>
+struct zip_control {
+    Sources sources;
+    completion_queue queue;
+    relay_group<zip_control> relays;
+    bool ended = false;
+
+    zip_control(Sources&& srcs):
+        sources(std::move(srcs)), queue(sources.size()),
+        relays(*this, sources.size()) {}
+
+    std::coroutine_handle<> complete(std::size_t id)
+        { return queue.push(id); }
+
+    void pull_all() {
+        for (std::size_t i = 0; i < sources.size(); ++i) {
+            sources.visit(i,
+                [&](auto& it) { ops::await_launch(it, relays[i]); });
+        }
+    }
+
+    void collect() {
+        while (queue.pop()) {}
+        for (std::size_t i = 0; i < sources.size(); ++i) {
+            sources.visit(i, [&](auto& it) {
+                if (!it.done()) { return; }
+                // rethrows exception of a source that threw
+                if (it != std::default_sentinel) { (void)*it; }
+                ended = true;
+            });
+        }
+    }
+};
+
+} // namespace _
+
+/**
+ * @brief Pulls the next item of multiple async generators in parallel and
+ *        yields them together.
+ *
+ * Construct this with `coutils::zip`. Dereferencing the iterator gives a
+ * tuple of references to the items, which stay in the frames of sources.
+ * Iteration ends when any source returns, and an exception thrown by any
+ * source is rethrown when awaiting the iterator.
+ *
+ * The caller may be resumed on the thread of any source.
+ *
+ * This class will cause N + 2 heap allocations when first awaited, and none
+ * per item.
+ */
+template <typename... Gs>
+class zip_stream {
+    using _Sources = _::tuple_sources<Gs...>;
+    using _Control = _::zip_control<_Sources>;
+
+    std::optional<_Sources> sources;
+    std::unique_ptr<_Control> control;
+
+    bool on_suspend(std::coroutine_handle<> ch) {
+        if (!control) {
+            control = std::make_unique<_Control>(std::move(*sources));
+            sources.reset();
+        }
+        control->pull_all();
+        return control->queue.wait(ch, sizeof...(Gs));
+    }
+
+public:
+    zip_stream(Gs&&... gens) : sources(std::in_place, std::move(gens)...) {}
+
+    class iterator {
+        zip_stream* ptr;
+
+    public:
+        iterator(zip_stream& parent) : ptr(std::addressof(parent)) {}
+
+        iterator(const iterator&) = delete;
+        iterator(iterator&& other):
+            ptr(std::exchange(other.ptr, nullptr)) {}
+
+        bool operator==(std::default_sentinel_t) const
+            { return ptr->control->ended; }
+        decltype(auto) operator*() {
+            return std::apply([](auto&... its) {
+                return std::forward_as_tuple(*its...);
+            }, ptr->control->sources.its);
+        }
+        iterator& operator++() & { return *this; }
+
+        constexpr bool await_ready() const noexcept { return false; }
+        bool await_suspend(std::coroutine_handle<> ch)
+            { return ptr->on_suspend(ch); }
+        void await_resume() { ptr->control->collect(); }
+    };
+
+    decltype(auto) begin() { return iterator(*this); }
+    decltype(auto) end() const { return std::default_sentinel; }
+};
+
+template <typename... Ys, typename... Ss>
+auto zip(crt::async_generator<Ys, Ss>&&... gens) {
+    return zip_stream<crt::async_generator<Ys, Ss>...>(std::move(gens)...);
+}
+
+#pragma endregion zip
+
+#pragma region map_concurrent
+
+namespace _ {
+
+template <typename G, typename F>
+struct map_control {
+    using _Source = stream_iterator<G>;
+    using _Awaitable = std::invoke_result_t<F&, stream_item<G>>;
+    using _Awaiter = traits::awaiter_cvt_t<_Awaitable>;
+    using _Result = traits::co_await_t<_Awaitable>;
+
+    struct slot {
+        std::optional<_Awaitable> awaitable;
+        std::optional<non_value_wrapper<_Awaiter>> awaiter;
+        bool done = false;
+
+        void reset() { awaiter.reset(); awaitable.reset(); done = false; }
+    };
+
+    _Source source;
+    F fn;
+    std::size_t width;
+    std::unique_ptr<slot[]> slots;
+    completion_queue queue;
+    relay_group<map_control> relays;
+    crt::agent_handle advancer;
+
+    std::size_t next_in = 0, next_out = 0;
+    bool source_pending = false, source_ended = false, taken = false;
+    std::exception_ptr error;
+    std::coroutine_handle<> consumer;
+    std::optional<non_value_wrapper<_Result>> current;
+
+    map_control(_Source&& src, F&& f, std::size_t k):
+        source(std::move(src)), fn(std::move(f)), width(k),
+        slots(std::make_unique<slot[]>(k)), queue(k + 1),
+        relays(*this, k + 1), advancer(advance(*this).handle) {}
+
+    ~map_control() { advancer.destroy(); }
+
+    std::coroutine_handle<> complete(std::size_t id)
+        { return queue.push(id); }
+
+    slot& head() { return slots[next_out % width]; }
+
+    bool ready() {
+        if (next_out < next_in) { return head().done; }
+        return source_ended;
+    }
+
+    void release() {
+        if (!taken) { return; }
+        current.reset(); head().reset();
+        ++next_out; taken = false;
+    }
+
+    void refill() {
+        if (source_pending || source_ended) { return; }
+        if (next_in - next_out == width) { return; }
+        source_pending = true;
+        ops::await_launch(source, relays[width]);
+    }
+
+    void on_source() try {
+        source_pending = false;
+        if (source.done()) {
+            source_ended = true;
+            // rethrows exception of the source
+            if (source != std::default_sentinel) { (void)*source; }
+            return;
+        }
+        auto id = next_in % width;
+        auto& s = slots[id];
+        s.awaitable.emplace(std::invoke(fn, *source));
+        s.awaiter.emplace(ops::get_awaiter(
+            static_cast<_Awaitable&&>(*s.awaitable)));
+        ++next_in;
+        ops::await_launch(s.awaiter->get(), relays[id]);
+    } catch (...) {
+        source_ended = true;
+        error = std::current_exception();
+    }
+
+    bool poll() {
+        while (auto id = queue.pop()) {
+            if (*id == width) { on_source(); }
+            else { slots[*id].done = true; }
+            refill();
+        }
+        return ready();
+    }
+
+    static crt::agent advance(map_control& c) noexcept {
+        while (true) {
+            c.release();
+            c.refill();
+            while (!c.poll()) { co_await completion_wait{c.queue}; }
+            co_await transfer_to_handle{std::exchange(c.consumer, {})};
+        }
+    }
+
+    void on_resume() {
+        if (next_out == next_in) {
+            if (error) { std::rethrow_exception(error); }
+            return;
+        }
+        taken = true;
+        current.emplace(ops::await_resume(head().awaiter->get()));
+    }
+};
+
+} // namespace _
+
+/**
+ * @brief Applies an async transformation to items of an async generator,
+ *        keeping at most `k` transformations in flight.
+ *
+ * Construct this with `coutils::map_concurrent`. The callable is invoked
+ * with the item yielded by the source (which is only valid until the source
+ * is resumed, so take it by value if it is used after the first suspension)
+ * and should return an awaitable. Results are produced in source order, and
+ * dereferencing the iterator gives a reference to the current result.
+ *
+ * Exceptions thrown by a transformation are rethrown when awaiting the
+ * iterator for its result. Exceptions thrown by the source or the callable
+ * end the stream, and are rethrown after results launched before them.
+ *
+ * Progress is driven by an internal coroutine, so the caller may be resumed
+ * on the thread of the source or any transformation. Destroying this while
+ * transformations are still in flight is undefined.
+ *
+ * This class will cause k + 5 heap allocations (k + 1 relay coroutines, 1
+ * for the driving coroutine, 1 for slots, 1 for the completion ring and 1
+ * for a control block) when first awaited. Beyond the awaitables returned by
+ * the callable, it allocates nothing per item.
+ */
+template <typename G, typename F>
+class map_stream {
+    using _Control = _::map_control<G, F>;
+
+    std::optional<G> source;
+    std::optional<F> fn;
+    std::size_t width;
+    std::unique_ptr<_Control> control;
+
+    std::coroutine_handle<> on_suspend(std::coroutine_handle<> ch) {
+        if (!control) {
+            control = std::make_unique<_Control>(
+                source->begin(), std::move(*fn), width);
+            source.reset(); fn.reset();
+        }
+        control->consumer = ch;
+        return control->advancer;
+    }
+
+public:
+    map_stream(G&& gen, F&& f, std::size_t k):
+        source(std::move(gen)), fn(std::move(f)), width(k ? k : 1) {}
+
+    class iterator {
+        map_stream* ptr;
+
+    public:
+        iterator(map_stream& parent) : ptr(std::addressof(parent)) {}
+
+        iterator(const iterator&) = delete;
+        iterator(iterator&& other):
+            ptr(std::exchange(other.ptr, nullptr)) {}
+
+        bool operator==(std::default_sentinel_t) const
+            { return !ptr->control->taken; }
+        decltype(auto) operator*() { return ptr->control->current->get(); }
+        iterator& operator++() & { return *this; }
+
+        constexpr bool await_ready() const noexcept { return false; }
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<> ch)
+            { return ptr->on_suspend(ch); }
+        void await_resume() { ptr->control->on_resume(); }
+    };
+
+    decltype(auto) begin() { return iterator(*this); }
+    decltype(auto) end() const { return std::default_sentinel; }
+};
+
+template <typename Y, typename S, typename F>
+auto map_concurrent(crt::async_generator<Y, S>&& gen, F&& fn, std::size_t k) {
+    using _Fn = std::decay_t<F>;
+    return map_stream<crt::async_generator<Y, S>, _Fn>(
+        std::move(gen), _Fn(COUTILS_FWD(fn)), k);
+}
+
+#pragma endregion map_concurrent
+
+} // namespace coutils
+
+#endif // __COUTILS_MULTI_STREAM__
@@ -0,0 +1,228 @@
+#pragma once
+#ifndef __COUTILS_PARALLEL__
+#define __COUTILS_PARALLEL__
+
+#include <vector>
+#include <thread>
+#include <cstddef>
+#include <iterator>
+#include <algorithm>
+#include <functional>
+#include <type_traits>
+#include "coutils/executor.hpp"
+#include "coutils/thread_pool.hpp"
+#include "coutils/multi_await.hpp"
+#include "coutils/crt/async_fn.hpp"
+
+namespace coutils {
+
+/**
+ * @brief The pool used by parallel algorithms when no executor is given.
+ *
+ * Created on first use with one worker per hardware thread.
+ */
+inline thread_pool& parallel_pool() {
+    static thread_pool pool;
+    return pool;
+}
+
+namespace _ {
+
+inline std::size_t auto_grain(std::size_t n) noexcept {
+    // about 8 chunks per worker, to even out uneven chunks
+    std::size_t chunks = 8 * std::max(std::thread::hardware_concurrency(), 1u);
+    return std::max<std::size_t>(n / chunks, 1);
+}
+
+/**
+ * @brief Calls `body(lo, hi)` on chunks of `[lo, hi)` of at most `grain`
+ *        indices, splitting the range in halves run in parallel on `ex`.
+ */
+template <typename F>
+crt::async_fn<void> for_chunks(executor_ref ex, std::size_t lo, std::size_t hi, std::size_t grain, F& body) {
+    if (hi - lo <= grain) { body(lo, hi); co_return; }
+    auto mid = lo + (hi - lo) / 2;
+    co_await all_completed_on(ex,
+        for_chunks(ex, lo, mid, grain, body),
+        for_chunks(ex, mid, hi, grain, body)
+    );
+}
+
+template <typename T, typename It, typename Op>
+crt::async_fn<T> reduce_chunks(executor_ref ex, It first, std::size_t lo, std::size_t hi, std::size_t grain, Op& op) {
+    if (hi - lo <= grain) {
+        // a chunk is never empty, so its partial starts from its first element
+        T partial = first[lo];
+        for (auto i = lo + 1; i < hi; ++i) { partial = op(std::move(partial), first[i]); }
+        co_return partial;
+    }
+    auto mid = lo + (hi - lo) / 2;
+    auto [left, right] = co_await all_completed_on(ex,
+        reduce_chunks<T>(ex, first, lo, mid, grain, op),
+        reduce_chunks<T>(ex, first, mid, hi, grain, op)
+    );
+    co_return op(std::move(left), std::move(right));
+}
+
+/**
+ * @brief Stably merges sorted `[a, a_end)` and `[b, b_end)` into `out`,
+ *        splitting around the middle of the longer one.
+ */
+template <typename It, typename Out, typename Comp>
+crt::async_fn<void> merge_parallel(executor_ref ex, It a, It a_end, It b, It b_end, Out out, std::size_t grain, Comp& comp) {
+    auto na = std::size_t(a_end - a), nb = std::size_t(b_end - b);
+    // splitting the longer one needs at least 2 elements to make progress
+    if (na + nb <= grain || std::max(na, nb) < 2) {
+        while (a != a_end && b != b_end)
+            { *out++ = comp(*b, *a) ? std::move(*b++) : std::move(*a++); }
+        out = std::move(a, a_end, out);
+        std::move(b, b_end, out);
+        co_return;
+    }
+    It a_mid, b_mid;
+    if (na >= nb) {
+        a_mid = a + na / 2;
+        b_mid = std::lower_bound(b, b_end, *a_mid, std::ref(comp));
+    } else {
+        b_mid = b + nb / 2;
+        a_mid = std::upper_bound(a, a_end, *b_mid, std::ref(comp));
+    }
+    auto out_mid = out + ((a_mid - a) + (b_mid - b));
+    co_await all_completed_on(ex,
+        merge_parallel(ex, a, a_mid, b, b_mid, out, grain, comp),
+        merge_parallel(ex, a_mid, a_end, b_mid, b_end, out_mid, grain, comp)
+    );
+}
+
+template <typename It, typename Buf, typename Comp>
+crt::async_fn<void> sort_parallel(executor_ref ex, It first, It last, Buf buf, std::size_t grain, Comp& comp) {
+    auto n = std::size_t(last - first);
+    if (n <= grain) { std::stable_sort(first, last, std::ref(comp)); co_return; }
+    auto mid = first + n / 2;
+    co_await all_completed_on(ex,
+        sort_parallel(ex, first, mid, buf, grain, comp),
+        sort_parallel(ex, mid, last, buf + n / 2, grain, comp)
+    );
+    co_await merge_parallel(ex, first, mid, mid, last, buf, grain, comp);
+    auto move_back = [&](std::size_t lo, std::size_t hi)
+        { std::move(buf + lo, buf + hi, first + lo); };
+    co_await for_chunks(ex, 0, n, grain, move_back);
+}
+
+} // namespace _
+
+/**
+ * @brief Calls `f` on every element of `[first, last)` in parallel on `ex`.
+ *
+ * The range is split in halves recursively until a part has at most `grain`
+ * elements (chosen from the size of the range when 0), and parts are run on
+ * `ex` with `all_completed_on`. Exceptions thrown by `f` are rethrown when
+ * awaiting the result.
+ */
+template <std::random_access_iterator It, typename F>
+crt::async_fn<void> parallel_for(executor_ref ex, It first, It last, F f, std::size_t grain = 0) {
+    auto n = std::size_t(last - first);
+    if (n == 0) { co_return; }
+    auto body = [&](std::size_t lo, std::size_t hi)
+        { for (auto i = lo; i < hi; ++i) { f(first[i]); } };
+    co_await _::for_chunks(ex, 0, n, grain ? grain : _::auto_grain(n), body);
+}
+
+template <std::random_access_iterator It, typename F>
+crt::async_fn<void> parallel_for(It first, It last, F f, std::size_t grain = 0)
+    { return parallel_for(parallel_pool(), first, last, std::move(f), grain); }
+
+/**
+ * @brief Reduces `[first, last)` with `op` in parallel on `ex`, starting from
+ *        `init`.
+ *
+ * Every part of at most `grain` elements is reduced serially into a partial,
+ * and partials are combined pairwise up the splitting tree. Partials are kept
+ * per chunk rather than per worker, so elements are combined in their order
+ * and the result does not depend on which worker ran which chunk. `op` should
+ * be associative but need not be commutative, and results may differ from a
+ * serial fold when it is not associative (like floating point addition).
+ */
+template <std::random_access_iterator It, typename T, typename Op = std::plus<>>
+crt::async_fn<T> parallel_reduce(executor_ref ex, It first, It last, T init, Op op = {}, std::size_t grain = 0) {
+    auto n = std::size_t(last - first);
+    if (n == 0) { co_return init; }
+    auto partial = co_await _::reduce_chunks<T>(ex, first, 0, n, grain ? grain : _::auto_grain(n), op);
+    co_return op(std::move(init), std::move(partial));
+}
+
+template <std::random_access_iterator It, typename T, typename Op = std::plus<>>
+crt::async_fn<T> parallel_reduce(It first, It last, T init, Op op = {}, std::size_t grain = 0)
+    { return parallel_reduce(parallel_pool(), first, last, std::move(init), std::move(op), grain); }
+
+/**
+ * @brief Stably sorts `[first, last)` with `comp` in parallel on `ex`.
+ *
+ * A merge sort, where halves are sorted in parallel and merged by parallel
+ * merges into a buffer of the same size, which is allocated once. Parts of at
+ * most `grain` elements are sorted with `std::stable_sort`. Elements must be
+ * default constructible and movable.
+ */
+template <std::random_access_iterator It, typename Comp = std::less<>>
+crt::async_fn<void> parallel_sort(executor_ref ex, It first, It last, Comp comp = {}, std::size_t grain = 0) {
+    auto n = std::size_t(last - first);
+    if (n < 2) { co_return; }
+    std::vector<std::iter_value_t<It>> buffer(n);
+    co_await _::sort_parallel(ex, first, last, buffer.begin(), grain ? grain : _::auto_grain(n), comp);
+}
+
+template <std::random_access_iterator It, typename Comp = std::less<>>
+crt::async_fn<void> parallel_sort(It first, It last, Comp comp = {}, std::size_t grain = 0)
+    { return parallel_sort(parallel_pool(), first, last, std::move(comp), grain); }
+
+/**
+ * @brief Writes the inclusive prefix scan of `[first, last)` with `op` to
+ *        `out` in parallel on `ex`, and gets the iterator past the last one
+ *        written.
+ *
+ * Two passes over parts of at most `grain` elements: the first reduces every
+ * part in parallel, then sums of preceding parts are scanned serially, and the
+ * second scans every part in parallel starting from them. `op` should be
+ * associative. `out` may be `first`.
+ */
+template <std::random_access_iterator It, std::random_access_iterator Out, typename Op = std::plus<>>
+crt::async_fn<Out> parallel_scan(executor_ref ex, It first, It last, Out out, Op op = {}, std::size_t grain = 0) {
+    using _Value = std::iter_value_t<It>;
+    auto n = std::size_t(last - first);
+    if (n == 0) { co_return out; }
+    if (!grain) { grain = _::auto_grain(n); }
+    auto chunks = (n + grain - 1) / grain;
+    std::vector<_Value> sums(chunks);
+    auto reduce_pass = [&](std::size_t lo, std::size_t hi) {
+        for (auto c = lo; c < hi; ++c) {
+            auto begin = c * grain, end = std::min(begin + grain, n);
+            _Value sum = first[begin];
+            for (auto i = begin + 1; i < end; ++i) { sum = op(std::move(sum), first[i]); }
+            sums[c] = std::move(sum);
+        }
+    };
+    co_await _::for_chunks(ex, 0, chunks, 1, reduce_pass);
+    // `offsets[c]` is the sum of parts before part `c`
+    std::vector<_Value> offsets(chunks);
+    for (std::size_t c = 1; c < chunks; ++c)
+        { offsets[c] = c == 1 ? sums[0] : op(offsets[c - 1], sums[c - 1]); }
+    auto scan_pass = [&](std::size_t lo, std::size_t hi) {
+        for (auto c = lo; c < hi; ++c) {
+            auto begin = c * grain, end = std::min(begin + grain, n);
+            _Value acc = c == 0 ? _Value(first[begin]) : op(offsets[c], first[begin]);
+            out[begin] = acc;
+            for (auto i = begin + 1; i < end; ++i)
+                { acc = op(std::move(acc), first[i]); out[i] = acc; }
+        }
+    };
+    co_await _::for_chunks(ex, 0, chunks, 1, scan_pass);
+    co_return out + n;
+}
+
+template <std::random_access_iterator It, std::random_access_iterator Out, typename Op = std::plus<>>
+crt::async_fn<Out> parallel_scan(It first, It last, Out out, Op op = {}, std::size_t grain = 0)
+    { return parallel_scan(parallel_pool(), first, last, out, std::move(op), grain); }
+
+} // namespace coutils
+
+#endif // __COUTILS_PARALLEL__
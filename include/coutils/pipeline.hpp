@@ -0,0 +1,340 @@
+#pragma once
+#ifndef __COUTILS_PIPELINE__
+#define __COUTILS_PIPELINE__
+
+#include <tuple>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <cstdint>
+#include <utility>
+#include <optional>
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include <type_traits>
+#include "coutils/traits.hpp"
+#include "coutils/utility.hpp"
+#include "coutils/executor.hpp"
+#include "coutils/task_group.hpp"
+#include "coutils/crt/async_fn.hpp"
+
+namespace coutils {
+
+/**
+ * @brief How items pass a stage of a `pipeline`.
+ */
+enum class stage_mode {
+    // one item at a time, in the order produced by the source
+    serial_in_order,
+    // one item at a time, in any order
+    serial_out_of_order,
+    // any number of items at a time
+    parallel,
+};
+
+/**
+ * @brief A stage of a `pipeline`, made with `stage<mode>(fn)`.
+ */
+template <stage_mode M, typename F>
+struct pipeline_stage {
+    static constexpr stage_mode mode = M;
+    using fn_type = F;
+    F fn;
+};
+
+template <stage_mode M, typename F>
+pipeline_stage<M, std::decay_t<F>> stage(F&& fn)
+    { return {COUTILS_FWD(fn)}; }
+
+namespace _ {
+
+/**
+ * @brief Admits one awaiting coroutine at a time in FIFO order.
+ */
+class serial_gate {
+    default_lock lock;
+    bool busy = false;
+
+public:
+    explicit serial_gate(std::size_t = 0) {}
+
+    class awaiter {
+        friend class serial_gate;
+        serial_gate& gate;
+        awaiter* next = nullptr;
+        std::coroutine_handle<> handle;
+
+    public:
+        awaiter(serial_gate& gate) : gate(gate) {}
+        awaiter(awaiter&& other) : gate(other.gate) {}
+
+        constexpr bool await_ready() const noexcept { return false; }
+        bool await_suspend(std::coroutine_handle<> h) {
+            auto guard = std::lock_guard(gate.lock);
+            if (!gate.busy) { gate.busy = true; return false; }
+            handle = h;
+            if (gate.tail) { gate.tail->next = this; } else { gate.head = this; }
+            gate.tail = this;
+            return true;
+        }
+        constexpr void await_resume() const noexcept {}
+    };
+
+    awaiter enter(std::uint64_t) { return awaiter(*this); }
+
+    /**
+     * @brief Admits the next waiting coroutine, and gets it to be resumed.
+     */
+    std::coroutine_handle<> leave() {
+        auto guard = std::lock_guard(lock);
+        if (!head) { busy = false; return nullptr; }
+        auto next = std::exchange(head, head->next);
+        if (!head) { tail = nullptr; }
+        return next->handle;
+    }
+
+private:
+    awaiter* head = nullptr;
+    awaiter* tail = nullptr;
+};
+
+/**
+ * @brief Admits awaiting coroutines one at a time in the order of their
+ *        sequence numbers.
+ *
+ * Sequence numbers of waiting coroutines are less than `window` ahead of the
+ * next admitted one, so they are parked in a ring of `window` slots.
+ */
+class ordered_gate {
+    default_lock lock;
+    std::uint64_t next = 0;
+    std::size_t window;
+    std::unique_ptr<std::coroutine_handle<>[]> parked;
+
+public:
+    explicit ordered_gate(std::size_t window):
+        window(window), parked(std::make_unique<std::coroutine_handle<>[]>(window)) {}
+
+    class awaiter {
+        ordered_gate& gate;
+        std::uint64_t seq;
+
+    public:
+        awaiter(ordered_gate& gate, std::uint64_t seq) : gate(gate), seq(seq) {}
+
+        constexpr bool await_ready() const noexcept { return false; }
+        bool await_suspend(std::coroutine_handle<> h) {
+            auto guard = std::lock_guard(gate.lock);
+            if (seq == gate.next) { return false; }
+            gate.parked[seq % gate.window] = h;
+            return true;
+        }
+        constexpr void await_resume() const noexcept {}
+    };
+
+    awaiter enter(std::uint64_t seq) { return awaiter(*this, seq); }
+
+    std::coroutine_handle<> leave() {
+        auto guard = std::lock_guard(lock);
+        ++next;
+        return std::exchange(parked[next % window], nullptr);
+    }
+};
+
+struct open_gate {
+    explicit open_gate(std::size_t) {}
+    std::suspend_never enter(std::uint64_t) { return {}; }
+    std::coroutine_handle<> leave() { return nullptr; }
+};
+
+template <stage_mode M>
+using gate_for = std::conditional_t<M == stage_mode::serial_in_order, ordered_gate,
+    std::conditional_t<M == stage_mode::serial_out_of_order, serial_gate, open_gate>>;
+
+template <typename Tuple>
+struct optional_slots;
+
+template <typename... Ts>
+struct optional_slots<std::tuple<Ts...>> { using type = std::tuple<std::optional<Ts>...>; };
+
+/**
+ * @brief Input types of stages, starting from the item type of the source.
+ */
+template <typename In, typename... Stages>
+struct stage_inputs;
+
+template <typename In, typename S>
+struct stage_inputs<In, S> { using type = std::tuple<In>; };
+
+template <typename In, typename S, typename Next, typename... Rest>
+struct stage_inputs<In, S, Next, Rest...> {
+    using _Out = traits::co_await_t<std::invoke_result_t<typename S::fn_type&, In&&>>;
+    static_assert(!std::is_void_v<_Out>, "only the last stage of a pipeline can result in nothing");
+    using type = decltype(std::tuple_cat(
+        std::declval<std::tuple<In>>(),
+        std::declval<typename stage_inputs<_Out, Next, Rest...>::type>()
+    ));
+};
+
+/**
+ * @brief Awaits the result of a stage and stores it as input of the next one,
+ *        or does nothing when the stage is skipped.
+ */
+template <typename A, typename Out>
+class stage_call {
+    std::optional<A> call;
+    Out* out;
+    std::exception_ptr& error;
+
+public:
+    stage_call(std::optional<A>&& call, Out* out, std::exception_ptr& error):
+        call(std::move(call)), out(out), error(error) {}
+    stage_call(stage_call&&) = default;
+
+    bool await_ready() const noexcept { return !call; }
+    template <typename P>
+    decltype(auto) await_suspend(std::coroutine_handle<P> h)
+        { return call->await_suspend(h); }
+    void await_resume() {
+        if (!call) { return; }
+        try {
+            if constexpr (std::is_void_v<traits::await_resume_t<A>> || std::is_same_v<Out, void>)
+                { call->await_resume(); }
+            else { out->emplace(call->await_resume()); }
+        } catch (...) { error = std::current_exception(); }
+    }
+};
+
+} // namespace _
+
+/**
+ * @brief A reusable chain of coroutine stages run over items of a source.
+ *
+ * The source is called as `source()` and should give an awaiter (like
+ * `async_fn`) resulting in `std::optional<T>`, where `std::nullopt` ends the
+ * input. It is called one at a time in order. Every stage is called with the
+ * result of the previous one as an rvalue, and should give an awaiter too.
+ * Only the last stage may result in nothing. Items are moved along stages and
+ * never copied.
+ *
+ * `co_await p.run(ex, tokens)` processes all items on executor `ex` with at
+ * most `tokens` items in flight, which bounds memory use. Each token is a
+ * coroutine carrying one item through all stages. When a token leaves a
+ * serial stage, the next token waiting for it is posted to `ex`, so different
+ * stages run in parallel on different items. `serial_in_order` stages admit
+ * items in the order of the source, parking early ones in a reorder buffer of
+ * `tokens` slots.
+ *
+ * After a stage throws, no more items are read, items in flight skip the
+ * remaining stages, and the first exception is rethrown by `run`. The
+ * pipeline must outlive awaiting `run`.
+ *
+ * Besides calls of the source and stages, running allocates the frame of
+ * `run`, a frame per token, the slots of a `task_group` spawning tokens and a
+ * reorder buffer per `serial_in_order` stage, all before the first item.
+ */
+template <typename Source, typename... Stages>
+class pipeline {
+    using _Item = typename traits::co_await_t<std::invoke_result_t<Source&>>::value_type;
+    using _Inputs = typename _::stage_inputs<_Item, Stages...>::type;
+    using _Slots = typename _::optional_slots<_Inputs>::type;
+    using _Gates = std::tuple<_::gate_for<Stages::mode>...>;
+
+    Source source;
+    std::tuple<Stages...> stages;
+
+    struct run_state {
+        executor_ref ex;
+        _::serial_gate input;
+        _Gates gates;
+        bool ended = false;
+        std::uint64_t produced = 0;
+        std::atomic<bool> failed = false;
+        default_lock error_lock;
+        std::exception_ptr error;
+
+        run_state(executor_ref ex, std::size_t tokens):
+            ex(ex), gates(((void)sizeof(Stages), tokens)...) {}
+
+        void resume(std::coroutine_handle<> h) {
+            if (!h) { return; }
+            if (ex) { ex.post(h); } else { ops::resume_trampolined(h); }
+        }
+
+        void fail(std::exception_ptr e) {
+            auto guard = std::lock_guard(error_lock);
+            if (!error) { error = std::move(e); }
+            failed.store(true, std::memory_order::release);
+        }
+    };
+
+    template <std::size_t I>
+    auto call_stage(run_state& st, _Slots& slots, std::exception_ptr& error) {
+        using _Stage = std::tuple_element_t<I, std::tuple<Stages...>>;
+        using _In = std::tuple_element_t<I, _Inputs>;
+        using _Call = std::invoke_result_t<typename _Stage::fn_type&, _In&&>;
+        using _Out = std::conditional_t<(I + 1 < sizeof...(Stages)),
+            std::tuple_element_t<std::min(I + 1, sizeof...(Stages) - 1), _Slots>, void>;
+        static_assert(traits::awaiter<_Call>, "pipeline stages should give awaiters like async_fn");
+
+        std::optional<_Call> call;
+        _Out* out = nullptr;
+        if constexpr (!std::is_void_v<_Out>) { out = std::addressof(std::get<I + 1>(slots)); }
+        if (!st.failed.load(std::memory_order::acquire)) try {
+            call.emplace(std::invoke(std::get<I>(stages).fn, std::move(*std::get<I>(slots))));
+        } catch (...) { st.fail(std::current_exception()); }
+        return _::stage_call<_Call, _Out>(std::move(call), out, error);
+    }
+
+    template <std::size_t... Is>
+    static crt::async_fn<void> token(pipeline& self, run_state& st, std::index_sequence<Is...>) {
+        co_await _::post_to{st.ex};
+        while (true) {
+            _Slots slots;
+            std::exception_ptr error;
+            bool got = false;
+            std::uint64_t seq = 0;
+            co_await st.input.enter(0);
+            if (!st.ended && !st.failed.load(std::memory_order::acquire)) {
+                try {
+                    auto item = co_await self.source();
+                    if (item) { std::get<0>(slots).emplace(std::move(*item)); got = true; }
+                } catch (...) { st.fail(std::current_exception()); }
+                if (got) { seq = st.produced++; } else { st.ended = true; }
+            }
+            st.resume(st.input.leave());
+            if (!got) { break; }
+            (..., (
+                co_await std::get<Is>(st.gates).enter(seq),
+                co_await self.template call_stage<Is>(st, slots, error),
+                error ? st.fail(std::exchange(error, nullptr)) : void(),
+                st.resume(std::get<Is>(st.gates).leave())
+            ));
+        }
+    }
+
+public:
+    pipeline(Source source, Stages... stages):
+        source(std::move(source)), stages(std::move(stages)...) {}
+
+    /**
+     * @brief Processes all items from the source, with at most `tokens` in
+     *        flight, on `ex`.
+     */
+    crt::async_fn<void> run(executor_ref ex, std::size_t tokens) {
+        if (tokens == 0) { tokens = 1; }
+        run_state st(ex, tokens);
+        {
+            task_group group(tokens);
+            for (std::size_t i = 0; i < tokens; ++i)
+                { co_await group.spawn(token(*this, st, std::index_sequence_for<Stages...>{})); }
+            co_await group.join();
+        }
+        if (st.error) { std::rethrow_exception(st.error); }
+    }
+};
+
+} // namespace coutils
+
+#endif // __COUTILS_PIPELINE__
@@ -0,0 +1,185 @@
+#pragma once
+#ifndef __COUTILS_PRIORITY_SCHEDULER__
+#define __COUTILS_PRIORITY_SCHEDULER__
+
+#include <mutex>
+#include <queue>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <optional>
+#include <algorithm>
+#include <coroutine>
+#include <functional>
+#include <condition_variable>
+#include "coutils/executor.hpp"
+
+namespace coutils {
+
+/**
+ * @brief A set of worker threads resuming posted coroutines by priority or
+ *        earliest deadline first.
+ *
+ * Every queued coroutine is ordered by a deadline. With `schedule_by` it is
+ * the given one. Otherwise it is a virtual deadline of `aging` per priority
+ * level below the highest, counted from the time it is queued. So queued work
+ * of any priority becomes the most urgent after waiting long enough, and
+ * batch work is never starved by a stream of urgent work. Ties are resumed in
+ * FIFO order.
+ *
+ * Priorities are clamped to `[0, levels)`, larger is more urgent. When the
+ * awaiting coroutine has a `schedule_hint` named `hint` in its promise, like
+ * `async_fn`, `schedule(...)` and `schedule_by(...)` store their attributes
+ * there, and `schedule()` reuses it. Since callees of `async_fn` copy the hint
+ * of their caller, priority is inherited along calls. Coroutines posted
+ * without such an awaitable (like a caller posted back after its callee
+ * finishes) get the hint of the coroutine running on calling worker.
+ *
+ * Destroying the scheduler waits until coroutines already posted are resumed
+ * and workers exit, so nothing should be posted to it at that time.
+ */
+class priority_scheduler {
+public:
+    using clock = schedule_hint::clock;
+
+private:
+    struct entry {
+        clock::time_point key;
+        std::uint64_t seq;
+        std::coroutine_handle<> handle;
+        schedule_hint hint;
+        bool operator>(const entry& other) const noexcept
+            { return key != other.key ? key > other.key : seq > other.seq; }
+    };
+
+    std::mutex lock;
+    std::condition_variable cv;
+    std::priority_queue<entry, std::vector<entry>, std::greater<>> queue;
+    std::uint64_t posted = 0;
+    bool stopping = false;
+    int levels;
+    clock::duration aging;
+    std::vector<std::thread> workers;
+
+    void run() {
+        auto scope = _::executor_scope(*this);
+        while (true) {
+            entry e;
+            {
+                auto guard = std::unique_lock(lock);
+                cv.wait(guard, [&] { return stopping || !queue.empty(); });
+                if (queue.empty()) { return; }
+                e = queue.top(); queue.pop();
+            }
+            _::current_hint = e.hint;
+            e.handle.resume();
+        }
+    }
+
+    clock::time_point key_of(const schedule_hint& hint) const {
+        if (hint.has_deadline()) { return hint.deadline; }
+        auto level = std::clamp(hint.priority, 0, levels - 1);
+        return clock::now() + aging * (levels - 1 - level);
+    }
+
+    template <typename P>
+    static schedule_hint* hint_of(std::coroutine_handle<P> h) noexcept {
+        if constexpr (requires { { h.promise().hint } -> std::same_as<schedule_hint&>; })
+            { return std::addressof(h.promise().hint); }
+        else { return nullptr; }
+    }
+
+public:
+    explicit priority_scheduler(
+        std::size_t n = std::thread::hardware_concurrency(),
+        int levels = 8, clock::duration aging = std::chrono::milliseconds(10)
+    ) : levels(std::max(levels, 1)), aging(aging) {
+        if (n == 0) { n = 1; }
+        workers.reserve(n);
+        for (std::size_t i = 0; i < n; ++i)
+            { workers.emplace_back([this] { run(); }); }
+    }
+
+    ~priority_scheduler() {
+        {
+            auto guard = std::lock_guard(lock);
+            stopping = true;
+        }
+        cv.notify_all();
+        for (auto&& w : workers) { w.join(); }
+    }
+
+    priority_scheduler(const priority_scheduler&) = delete;
+    priority_scheduler& operator=(const priority_scheduler&) = delete;
+
+    std::size_t size() const noexcept { return workers.size(); }
+
+    /**
+     * @brief Queues `h` with `hint`.
+     */
+    void post(std::coroutine_handle<> h, const schedule_hint& hint) {
+        auto key = key_of(hint);
+        // notify with lock held, so that the scheduler cannot be destroyed by
+        // the posted coroutine before this returns
+        auto guard = std::lock_guard(lock);
+        queue.push(entry{key, posted++, h, hint});
+        cv.notify_one();
+    }
+
+    /**
+     * @brief Queues `h` with the hint of the coroutine running on calling
+     *        worker, or the default hint when not called on a worker.
+     */
+    void post(std::coroutine_handle<> h)
+        { post(h, running_in_this_thread() ? _::current_hint : schedule_hint{}); }
+
+    bool running_in_this_thread() const noexcept
+        { return current_executor().address() == this; }
+
+    class schedule_awaiter {
+        priority_scheduler& sched;
+        // null to inherit
+        std::optional<schedule_hint> hint;
+
+    public:
+        schedule_awaiter(priority_scheduler& sched, std::optional<schedule_hint> hint):
+            sched(sched), hint(hint) {}
+        constexpr bool await_ready() const noexcept { return false; }
+        template <typename P>
+        void await_suspend(std::coroutine_handle<P> h) const {
+            auto stored = hint_of(h);
+            schedule_hint actual;
+            if (hint) { actual = *hint; }
+            else if (stored) { actual = *stored; }
+            else if (sched.running_in_this_thread()) { actual = _::current_hint; }
+            if (stored) { *stored = actual; }
+            sched.post(h, actual);
+        }
+        constexpr void await_resume() const noexcept {}
+    };
+
+    /**
+     * @brief Resumes the awaiting coroutine on a worker, keeping its current
+     *        hint.
+     */
+    schedule_awaiter schedule() { return schedule_awaiter(*this, std::nullopt); }
+
+    /**
+     * @brief Resumes the awaiting coroutine on a worker with `priority`.
+     */
+    schedule_awaiter schedule(int priority)
+        { return schedule_awaiter(*this, schedule_hint{.priority = priority}); }
+
+    /**
+     * @brief Resumes the awaiting coroutine on a worker before work with a
+     *        later deadline.
+     */
+    schedule_awaiter schedule_by(clock::time_point deadline)
+        { return schedule_awaiter(*this, schedule_hint{.deadline = deadline}); }
+};
+
+} // namespace coutils
+
+#endif // __COUTILS_PRIORITY_SCHEDULER__
@@ -0,0 +1,309 @@
+#pragma once
+#ifndef __COUTILS_RATE_LIMITER__
+#define __COUTILS_RATE_LIMITER__
+
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <cstdint>
+#include <utility>
+#include <algorithm>
+#include <coroutine>
+#include <stdexcept>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+#include "coutils/utility.hpp"
+#include "coutils/executor.hpp"
+#include "coutils/timer.hpp"
+#include "coutils/crt/agent.hpp"
+
+namespace coutils {
+
+/**
+ * @brief A token bucket limiting the rate of work done by coroutines.
+ *
+ * `co_await limiter.acquire(n)` takes `n` tokens, suspending until they are
+ * available. Tokens are refilled at `rate` per second up to `burst`, so at
+ * most `burst` tokens are taken at once after being idle. With `burst` 1 it
+ * is a leaky bucket, spacing acquisitions of 1 token evenly.
+ *
+ * The bucket is kept as the time it would be full again (the generic cell
+ * rate algorithm), so taking tokens while nobody waits is one CAS. Otherwise
+ * waiters queue in FIFO order in a list linked through their awaiters, so
+ * suspending allocates nothing, and only the first waiter is timed. Waiters
+ * are resumed on the executor running them when they suspended.
+ *
+ * Time is driven by `timer`, which wakes the limiter when its first waiter is
+ * due. With a null `timer`, time only moves when `pump(now)` is called, which
+ * suits event loops with a clock of their own, and tests.
+ *
+ * With a `parent`, tokens are taken from this first and then from the parent,
+ * so a limiter per key can share a global one, see `keyed_rate_limiter`. The
+ * limiter must outlive its waiters and its timers.
+ */
+class rate_limiter {
+public:
+    using clock = timer_queue::clock;
+
+    class acquire_awaiter {
+        friend class rate_limiter;
+        // the limiter to take tokens from next, null when done
+        rate_limiter* stage;
+        std::uint64_t n;
+        acquire_awaiter* next = nullptr;
+        std::coroutine_handle<> handle;
+        executor_ref ex;
+
+    public:
+        // checks every stage first, so that nothing is taken when one throws
+        acquire_awaiter(rate_limiter& limiter, std::uint64_t n) : stage(&limiter), n(n)
+            { limiter.check_all(n); }
+        acquire_awaiter(acquire_awaiter&& other) : stage(other.stage), n(other.n) {}
+
+        bool await_ready() {
+            while (stage && stage->try_fast(n)) { stage = stage->parent; }
+            return !stage;
+        }
+        bool await_suspend(std::coroutine_handle<> h) {
+            handle = h;
+            ex = current_executor();
+            return !proceed(this);
+        }
+        constexpr void await_resume() const noexcept {}
+    };
+
+private:
+    // nanoseconds per token
+    std::int64_t interval;
+    std::int64_t capacity;
+    rate_limiter* parent;
+    timer_queue* timer;
+    // when the bucket is full again, in nanoseconds since the clock epoch
+    std::atomic<std::int64_t> full_at = 0;
+    // the time set by `pump` when there is no timer
+    std::atomic<std::int64_t> pumped = 0;
+
+    default_lock lock;
+    acquire_awaiter* head = nullptr;
+    acquire_awaiter* tail = nullptr;
+    std::atomic<std::size_t> queued = 0;
+    // due time of the armed timer, 0 when none
+    std::int64_t armed = 0;
+
+    static std::int64_t to_ns(clock::time_point t) noexcept
+        { return std::chrono::duration_cast<std::chrono::nanoseconds>(t.time_since_epoch()).count(); }
+
+    std::int64_t now() const noexcept
+        { return timer ? to_ns(clock::now()) : pumped.load(std::memory_order::acquire); }
+
+    bool try_take(std::uint64_t n, std::int64_t t) noexcept {
+        auto full = full_at.load(std::memory_order::relaxed);
+        while (true) {
+            auto next = std::max(full, t) + std::int64_t(n) * interval;
+            if (next - t > capacity) { return false; }
+            if (full_at.compare_exchange_weak(full, next, std::memory_order::acq_rel, std::memory_order::relaxed)) { return true; }
+        }
+    }
+
+    // when `n` tokens are available, given nobody else takes them first
+    std::int64_t due(std::uint64_t n) const noexcept
+        { return full_at.load(std::memory_order::acquire) + std::int64_t(n) * interval - capacity; }
+
+    // waiters must not be overtaken, so the fast path only runs without them
+    bool try_fast(std::uint64_t n) noexcept
+        { return queued.load(std::memory_order::acquire) == 0 && try_take(n, now()); }
+
+    void check_all(std::uint64_t n) const {
+        for (auto stage = this; stage; stage = stage->parent) {
+            if (std::int64_t(n) * stage->interval > stage->capacity)
+                { throw std::invalid_argument("acquiring more tokens than the burst of a rate limiter"); }
+        }
+    }
+
+    /**
+     * @brief Takes tokens for `w` from its remaining stages, gets false when
+     *        it is queued somewhere.
+     *
+     * `n` of `w` is checked against every stage beforehand, so this does not
+     * throw, which matters on the thread of the timer.
+     */
+    static bool proceed(acquire_awaiter* w) noexcept {
+        while (w->stage) {
+            if (!w->stage->enter(w)) { return false; }
+            w->stage = w->stage->parent;
+        }
+        return true;
+    }
+
+    bool enter(acquire_awaiter* w) noexcept {
+        std::int64_t when;
+        {
+            auto guard = std::lock_guard(lock);
+            if (!head && try_take(w->n, now())) { return true; }
+            w->next = nullptr;
+            if (tail) { tail->next = w; } else { head = w; }
+            tail = w;
+            queued.fetch_add(1, std::memory_order::release);
+            if (head != w || !timer) { return false; }
+            when = due(w->n);
+            if (armed && armed <= when) { return false; }
+            armed = when;
+        }
+        // `w` may be resumed from here on
+        wake_at(*this, when).handle.resume();
+        return false;
+    }
+
+    struct at_time {
+        timer_queue& timer;
+        clock::time_point when;
+        constexpr bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> h) const { timer.post_at(when, h); }
+        constexpr void await_resume() const noexcept {}
+    };
+
+    static crt::agent wake_at(rate_limiter& self, std::int64_t when) noexcept {
+        co_await at_time{*self.timer, clock::time_point(std::chrono::duration_cast<clock::duration>(std::chrono::nanoseconds(when)))};
+        self.grant(true);
+    }
+
+    /**
+     * @brief Grants tokens to due waiters, then sends them on to their next
+     *        stage, and arms the timer for the first one left.
+     */
+    void grant(bool from_timer) noexcept {
+        acquire_awaiter* granted = nullptr;
+        acquire_awaiter* granted_tail = nullptr;
+        std::int64_t when = 0;
+        {
+            auto guard = std::lock_guard(lock);
+            if (from_timer) { armed = 0; }
+            auto t = now();
+            while (head && try_take(head->n, t)) {
+                auto w = std::exchange(head, head->next);
+                w->next = nullptr;
+                if (granted_tail) { granted_tail->next = w; } else { granted = w; }
+                granted_tail = w;
+                queued.fetch_sub(1, std::memory_order::release);
+            }
+            if (!head) { tail = nullptr; }
+            else if (timer && !armed) { armed = when = due(head->n); }
+        }
+        if (when) { wake_at(*this, when).handle.resume(); }
+        while (granted) {
+            // a resumed waiter destroys its awaiter
+            auto w = std::exchange(granted, granted->next);
+            w->stage = parent;
+            if (proceed(w)) { _::dispatch(w->ex, w->handle); }
+        }
+    }
+
+public:
+    /**
+     * @brief Makes a limiter of `rate` tokens per second, holding at most
+     *        `burst` tokens, which starts full.
+     */
+    rate_limiter(double rate, double burst, timer_queue* timer = &default_timer(), rate_limiter* parent = nullptr):
+        interval(std::max<std::int64_t>(std::int64_t(1e9 / rate), 1)),
+        capacity(std::int64_t(burst * double(interval))),
+        parent(parent), timer(timer) {
+        if (!(rate > 0) || !(burst >= 1)) { throw std::invalid_argument("bad rate limiter parameters"); }
+    }
+
+    rate_limiter(const rate_limiter&) = delete;
+    rate_limiter& operator=(const rate_limiter&) = delete;
+
+    /**
+     * @brief Takes `n` tokens, suspending until they are available.
+     *
+     * Throws `std::invalid_argument` when `n` is more than the burst of this
+     * or of a parent, before taking anything.
+     */
+    acquire_awaiter acquire(std::uint64_t n = 1) { return acquire_awaiter(*this, n); }
+
+    /**
+     * @brief Takes `n` tokens when available without waiting, and from the
+     *        parent too. Gets whether they were taken.
+     *
+     * Tokens already taken are not given back when the parent has too few.
+     * Throws like `acquire`.
+     */
+    bool try_acquire(std::uint64_t n = 1) {
+        check_all(n);
+        for (auto stage = this; stage; stage = stage->parent)
+            { if (!stage->try_fast(n)) { return false; } }
+        return true;
+    }
+
+    /**
+     * @brief Sets the time of a limiter without a timer to `now`, and resumes
+     *        waiters due by then.
+     */
+    void pump(clock::time_point now) {
+        auto t = to_ns(now);
+        auto seen = pumped.load(std::memory_order::relaxed);
+        while (seen < t && !pumped.compare_exchange_weak(seen, t, std::memory_order::release, std::memory_order::relaxed)) {}
+        grant(false);
+    }
+
+    void pump() { pump(clock::now()); }
+
+    /**
+     * @brief Counts suspended waiters.
+     */
+    std::size_t waiting() const noexcept { return queued.load(std::memory_order::relaxed); }
+};
+
+/**
+ * @brief A limiter per key, all sharing a global limiter.
+ *
+ * Limiters of keys are created on first use and kept as long as this.
+ */
+template <typename K, typename Hash = std::hash<K>, typename Eq = std::equal_to<K>>
+class keyed_rate_limiter {
+    double rate, burst;
+    timer_queue* timer;
+    rate_limiter global;
+    default_lock lock;
+    std::unordered_map<K, std::unique_ptr<rate_limiter>, Hash, Eq> limiters;
+
+public:
+    /**
+     * @brief Limits every key to `rate` per second with `burst`, and all keys
+     *        together to `global_rate` with `global_burst`.
+     */
+    keyed_rate_limiter(double rate, double burst, double global_rate, double global_burst,
+                       timer_queue* timer = &default_timer()):
+        rate(rate), burst(burst), timer(timer), global(global_rate, global_burst, timer) {}
+
+    rate_limiter& operator[](const K& key) {
+        auto guard = std::lock_guard(lock);
+        auto& limiter = limiters[key];
+        if (!limiter) { limiter = std::make_unique<rate_limiter>(rate, burst, timer, &global); }
+        return *limiter;
+    }
+
+    rate_limiter& shared() noexcept { return global; }
+
+    /**
+     * @brief Takes `n` tokens of `key` and of the global limiter.
+     */
+    rate_limiter::acquire_awaiter acquire(const K& key, std::uint64_t n = 1)
+        { return (*this)[key].acquire(n); }
+
+    void pump(rate_limiter::clock::time_point now) {
+        std::vector<rate_limiter*> all;
+        {
+            auto guard = std::lock_guard(lock);
+            for (auto&& [key, limiter] : limiters) { all.push_back(limiter.get()); }
+        }
+        for (auto limiter : all) { limiter->pump(now); }
+        global.pump(now);
+    }
+};
+
+} // namespace coutils
+
+#endif // __COUTILS_RATE_LIMITER__
@@ -0,0 +1,62 @@
+#pragma once
+#ifndef __COUTILS_RELAY__
+#define __COUTILS_RELAY__
+
+#include <memory>
+#include <coroutine>
+#include "coutils/utility.hpp"
+#include "coutils/crt/agent.hpp"
+
+namespace coutils::_ {
+
+template <typename Ctx>
+struct relay_point {
+    Ctx& ctx;
+    std::size_t id;
+    constexpr bool await_ready() const noexcept { return false; }
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<>) const {
+        auto next = ctx.complete(id);
+        return next ? next : std::noop_coroutine();
+    }
+    constexpr void await_resume() const noexcept {}
+};
+
+/**
+ * @brief A reusable continuation reporting completions of producer `id`.
+ *
+ * It is set as the caller of a producer over and over. Every time it is
+ * resumed, `ctx.complete(id)` is called exactly once after the relay is
+ * suspended, and control is transferred to the returned handle (or back to
+ * whoever resumed the relay if it is null).
+ *
+ * A relay never finishes, it is destroyed by `relay_group`.
+ */
+template <typename Ctx>
+static crt::agent relay(Ctx& ctx, std::size_t id) noexcept {
+    while (true) { co_await relay_point<Ctx>{ctx, id}; }
+}
+
+template <typename Ctx>
+class relay_group {
+    std::unique_ptr<crt::agent_handle[]> relays;
+    std::size_t count;
+
+public:
+    relay_group(Ctx& ctx, std::size_t n):
+        relays(std::make_unique<crt::agent_handle[]>(n)), count(n) {
+        for (std::size_t i = 0; i < n; ++i)
+            { relays[i] = relay(ctx, i).handle; }
+    }
+    ~relay_group() {
+        for (std::size_t i = 0; i < count; ++i) { relays[i].destroy(); }
+    }
+    relay_group(const relay_group&) = delete;
+    relay_group& operator=(const relay_group&) = delete;
+
+    std::coroutine_handle<> operator[](std::size_t i) const noexcept
+        { return relays[i]; }
+};
+
+} // namespace coutils::_
+
+#endif // __COUTILS_RELAY__
@@ -0,0 +1,323 @@
+#pragma once
+#ifndef __COUTILS_SHARDED_EXECUTOR__
+#define __COUTILS_SHARDED_EXECUTOR__
+
+#include <bit>
+#include <mutex>
+#include <deque>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <cstddef>
+#include <algorithm>
+#include <coroutine>
+#include "coutils/executor.hpp"
+#include "coutils/locks.hpp"
+#include "coutils/crt/async_fn.hpp"
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace coutils {
+
+namespace _ {
+
+/**
+ * @brief A bounded lock-free ring with one producer thread and one consumer
+ *        thread.
+ *
+ * Each side caches the index of the other side, so it only reads the shared
+ * one when the ring looks full or empty.
+ */
+template <typename T>
+class spsc_ring {
+    using enum std::memory_order;
+
+    // written by the consumer
+    alignas(64) std::atomic<std::size_t> head = 0;
+    std::size_t cached_tail = 0;
+    // written by the producer
+    alignas(64) std::atomic<std::size_t> tail = 0;
+    std::size_t cached_head = 0;
+    alignas(64) std::size_t mask;
+    std::unique_ptr<T[]> slots;
+
+public:
+    explicit spsc_ring(std::size_t capacity):
+        mask(std::bit_ceil(std::max<std::size_t>(capacity, 2)) - 1),
+        slots(std::make_unique<T[]>(mask + 1)) {}
+
+    /**
+     * @brief Pushes `value`, fails when full. Called by the producer.
+     */
+    bool push(const T& value) noexcept {
+        auto t = tail.load(relaxed);
+        if (t - cached_head > mask) {
+            cached_head = head.load(acquire);
+            if (t - cached_head > mask) { return false; }
+        }
+        slots[t & mask] = value;
+        tail.store(t + 1, release);
+        return true;
+    }
+
+    /**
+     * @brief Calls `f` on at most `max` values in FIFO order and pops them.
+     *        Called by the consumer.
+     */
+    template <typename F>
+    std::size_t pop_batch(F&& f, std::size_t max) {
+        auto h = head.load(relaxed);
+        if (h == cached_tail) {
+            cached_tail = tail.load(acquire);
+            if (h == cached_tail) { return 0; }
+        }
+        auto n = std::min(cached_tail - h, max);
+        for (std::size_t i = 0; i < n; ++i) { f(slots[(h + i) & mask]); }
+        head.store(h + n, release);
+        return n;
+    }
+
+    /**
+     * @brief Checks for values without popping. Called by the consumer.
+     */
+    bool empty() const noexcept
+        { return head.load(seq_cst) == tail.load(seq_cst); }
+};
+
+} // namespace _
+
+/**
+ * @brief A share-nothing executor with one event loop thread per shard.
+ *
+ * Each shard is an executor of its own, running coroutines posted to it on
+ * its thread only, so data owned by a shard needs no synchronization. On
+ * Linux, shard `i` is pinned to CPU `i` modulo the number of CPUs unless
+ * `pin` is false.
+ *
+ * Posting from a shard to another goes through a lock-free SPSC ring owned by
+ * that pair of shards, and the receiving shard drains its rings in batches of
+ * `batch` handles. When a ring is full, handles are kept by the sending shard
+ * and retried later, so posting never blocks. Posting from a thread not
+ * belonging to the executor goes through a locked inbox.
+ *
+ * Rings are allocated once on construction. Run `async_fn`s on a shard with
+ * `co_await submit_to(exec[i], fn())`.
+ *
+ * Destroying the executor waits until coroutines already posted are resumed
+ * and shards exit, so nothing should be running on it at that time.
+ */
+class sharded_executor {
+    using enum std::memory_order;
+    using _Ring = _::spsc_ring<std::coroutine_handle<>>;
+
+public:
+    static constexpr std::size_t npos = std::size_t(-1);
+
+    class shard {
+        friend class sharded_executor;
+
+        sharded_executor& owner;
+        std::size_t id;
+        // only accessed by the shard thread
+        std::deque<std::coroutine_handle<>> local;
+        std::vector<std::deque<std::coroutine_handle<>>> overflow;
+        std::size_t overflowed = 0;
+        // for threads not belonging to the executor
+        light_lock inbox_lock;
+        std::vector<std::coroutine_handle<>> inbox;
+        std::atomic<bool> has_inbox = false;
+        // parking
+        std::atomic<std::uint32_t> wakeups = 0;
+        std::atomic<bool> sleeping = false;
+
+        shard(sharded_executor& owner, std::size_t id):
+            owner(owner), id(id), overflow(owner.count) {}
+
+        void wake() noexcept {
+            wakeups.fetch_add(1, seq_cst);
+            if (sleeping.load(seq_cst)) { wakeups.notify_one(); }
+        }
+
+        bool pending() const noexcept {
+            if (!local.empty() || overflowed || has_inbox.load(seq_cst)) { return true; }
+            for (std::size_t from = 0; from < owner.count; ++from)
+                { if (!owner.ring(from, id).empty()) { return true; } }
+            return false;
+        }
+
+        bool poll() {
+            bool progress = false;
+            auto take = [this](std::coroutine_handle<> h) { local.push_back(h); };
+            for (std::size_t from = 0; from < owner.count; ++from)
+                { progress |= owner.ring(from, id).pop_batch(take, owner.batch) != 0; }
+            if (has_inbox.load(acquire)) {
+                auto guard = std::lock_guard(inbox_lock);
+                local.insert(local.end(), inbox.begin(), inbox.end());
+                inbox.clear();
+                has_inbox.store(false, relaxed);
+                progress = true;
+            }
+            if (overflowed) {
+                for (std::size_t to = 0; to < owner.count; ++to) {
+                    auto& q = overflow[to];
+                    std::size_t moved = 0;
+                    while (!q.empty() && owner.ring(id, to).push(q.front()))
+                        { q.pop_front(); ++moved; }
+                    if (moved) { overflowed -= moved; progress = true; owner.shards[to]->wake(); }
+                }
+            }
+            for (std::size_t i = 0, n = std::min(local.size(), owner.batch); i < n; ++i) {
+                auto h = local.front(); local.pop_front();
+                h.resume();
+                progress = true;
+            }
+            return progress;
+        }
+
+        void run() {
+            auto scope = _::executor_scope(*this);
+            current = this;
+            while (true) {
+                if (poll()) { continue; }
+                if (owner.stopping.load(acquire) && !pending()) { break; }
+                // see `wake`, either this sees new work or the poster sees
+                // `sleeping` and notifies
+                sleeping.store(true, seq_cst);
+                auto seen = wakeups.load(seq_cst);
+                if (!pending() && !owner.stopping.load(seq_cst)) { wakeups.wait(seen, seq_cst); }
+                sleeping.store(false, relaxed);
+            }
+            current = nullptr;
+        }
+
+    public:
+        shard(const shard&) = delete;
+        shard& operator=(const shard&) = delete;
+
+        std::size_t index() const noexcept { return id; }
+
+        void post(std::coroutine_handle<> h) {
+            auto from = current;
+            if (from == this) { local.push_back(h); return; }
+            if (from && &from->owner == &owner) {
+                auto& q = from->overflow[id];
+                if (!q.empty() || !owner.ring(from->id, id).push(h))
+                    { q.push_back(h); ++from->overflowed; return; }
+            } else {
+                auto guard = std::lock_guard(inbox_lock);
+                inbox.push_back(h);
+                has_inbox.store(true, release);
+            }
+            wake();
+        }
+
+        bool running_in_this_thread() const noexcept { return current == this; }
+    };
+
+private:
+    static inline thread_local shard* current = nullptr;
+
+    std::size_t count, batch;
+    std::vector<std::unique_ptr<_Ring>> rings;
+    std::vector<std::unique_ptr<shard>> shards;
+    std::atomic<bool> stopping = false;
+    std::vector<std::thread> threads;
+
+    _Ring& ring(std::size_t from, std::size_t to) noexcept
+        { return *rings[from * count + to]; }
+
+    static void pin_to(std::thread& t, std::size_t i) {
+#ifdef __linux__
+        auto cpus = std::max(std::thread::hardware_concurrency(), 1u);
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(i % cpus, &set);
+        // best effort, failing leaves the thread unpinned
+        pthread_setaffinity_np(t.native_handle(), sizeof(set), &set);
+#else
+        (void)t; (void)i;
+#endif
+    }
+
+public:
+    explicit sharded_executor(
+        std::size_t n = std::thread::hardware_concurrency(),
+        std::size_t ring_capacity = 256, std::size_t batch = 64, bool pin = true
+    ) : count(n ? n : 1), batch(batch ? batch : 1) {
+        rings.reserve(count * count);
+        for (std::size_t i = 0; i < count * count; ++i)
+            { rings.push_back(std::make_unique<_Ring>(ring_capacity)); }
+        shards.reserve(count);
+        for (std::size_t i = 0; i < count; ++i)
+            { shards.emplace_back(new shard(*this, i)); }
+        threads.reserve(count);
+        for (std::size_t i = 0; i < count; ++i) {
+            threads.emplace_back([this, i] { shards[i]->run(); });
+            if (pin) { pin_to(threads.back(), i); }
+        }
+    }
+
+    ~sharded_executor() {
+        stopping.store(true, seq_cst);
+        for (auto&& s : shards) { s->wake(); }
+        for (auto&& t : threads) { t.join(); }
+    }
+
+    sharded_executor(const sharded_executor&) = delete;
+    sharded_executor& operator=(const sharded_executor&) = delete;
+
+    std::size_t size() const noexcept { return count; }
+    shard& operator[](std::size_t i) noexcept { return *shards[i]; }
+
+    /**
+     * @brief Gets the index of the shard running calling thread, `npos` when
+     *        it is not a shard of this executor.
+     */
+    std::size_t current_shard() const noexcept
+        { return current && &current->owner == this ? current->id : npos; }
+};
+
+namespace _ {
+
+template <typename T>
+class submit_awaiter {
+    crt::async_fn<T> fn;
+    executor_ref ex;
+
+public:
+    submit_awaiter(executor_ref ex, crt::async_fn<T>&& fn):
+        fn(std::move(fn)), ex(ex) {}
+    submit_awaiter(submit_awaiter&&) = default;
+
+    constexpr bool await_ready() const noexcept { return false; }
+    template <typename P>
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<P> ch) {
+        auto callee = fn.await_suspend(ch);
+        if (!ex || ex.running_in_this_thread()) { return callee; }
+        // `this` may be gone once posted
+        ex.post(callee);
+        return std::noop_coroutine();
+    }
+    decltype(auto) await_resume() { return fn.await_resume(); }
+};
+
+} // namespace _
+
+/**
+ * @brief Runs `fn` on `ex` and gets its result.
+ *
+ * The awaiting coroutine is resumed on its own executor afterwards, as with
+ * awaiting `fn` directly. Runs `fn` inline when `ex` already runs calling
+ * thread.
+ */
+template <typename T>
+_::submit_awaiter<T> submit_to(executor_ref ex, crt::async_fn<T>&& fn)
+    { return _::submit_awaiter<T>(ex, std::move(fn)); }
+
+} // namespace coutils
+
+#endif // __COUTILS_SHARDED_EXECUTOR__
@@ -0,0 +1,207 @@
+#pragma once
+#ifndef __COUTILS_SHARED_SOURCE__
+#define __COUTILS_SHARED_SOURCE__
+
+#include <span>
+#include <atomic>
+#include <cstdint>
+#include <optional>
+#include "coutils/utility.hpp"
+#include "coutils/traits.hpp"
+#include "coutils/crt/agent.hpp"
+#include "coutils/crt/async_generator.hpp"
+
+namespace coutils {
+
+/**
+ * @brief Distributes items of one async generator among many consumers.
+ *
+ * Any number of coroutines, possibly on different threads, can pull from
+ * this with `co_await src.next()` (which gives `std::optional<value_type>`,
+ * empty after the generator returns) or `co_await src.next_batch(span)`
+ * (which fills up to `span.size()` items and gives the count, 0 after the
+ * generator returns). Every item is moved to exactly one consumer (or copied
+ * when the generator yields lvalue references).
+ *
+ * The generator is driven by an internal pump coroutine. A consumer that
+ * finds the pump idle starts it on its own thread, otherwise it pushes itself
+ * onto a lock-free waiter stack and suspends. The pump serves waiters in
+ * arrival order, resuming each one directly when its request is filled. While
+ * other waiters are pending, served consumers are resumed inline on the pump
+ * thread, so consumers doing heavy work should move to their own executor
+ * after getting an item. Pulling in batches amortizes this handoff.
+ *
+ * An exception thrown by the generator is rethrown to the consumer being
+ * served when it happens, and later consumers see the end of stream.
+ *
+ * This must outlive every pending pull. Creating it causes 1 heap allocation
+ * for the pump coroutine, pulling allocates nothing.
+ */
+template <typename G>
+class shared_source {
+    using enum std::memory_order;
+    using _Source = decltype(std::declval<G&>().begin());
+    using _Item = decltype(*std::declval<_Source&>());
+
+public:
+    using value_type = std::remove_cvref_t<_Item>;
+
+private:
+    struct waiter {
+        waiter* next = nullptr;
+        std::coroutine_handle<> handle;
+        std::optional<value_type>* single = nullptr;
+        std::span<value_type> batch;
+        std::size_t capacity = 1, count = 0;
+        std::exception_ptr error;
+
+        void put(auto&& item) {
+            if (single) { single->emplace(COUTILS_FWD(item)); }
+            else { batch[count] = COUTILS_FWD(item); }
+            ++count;
+        }
+    };
+
+    // `state` is `IDLE`, `BUSY` (pump running, no waiter pushed), or the top
+    // of a stack of waiters pushed while the pump is running.
+    static constexpr std::uintptr_t IDLE = 1, BUSY = 0;
+
+    _Source source;
+    std::atomic<std::uintptr_t> state = IDLE;
+    std::atomic<bool> ended = false;
+    waiter* fifo = nullptr;
+    crt::agent_handle pump_handle;
+
+    // Following members are only accessed by whoever runs the pump.
+
+    waiter* take() {
+        if (!fifo && state.load(relaxed) != BUSY) {
+            auto top = state.exchange(BUSY, acquire);
+            // reverse the stack, so that waiters are served in FIFO order
+            for (auto w = reinterpret_cast<waiter*>(top); w; ) {
+                auto next = w->next;
+                w->next = fifo; fifo = w; w = next;
+            }
+        }
+        return fifo ? std::exchange(fifo, fifo->next) : nullptr;
+    }
+
+    bool try_release() {
+        auto expected = BUSY;
+        return state.compare_exchange_strong(expected, IDLE, release, relaxed);
+    }
+
+    struct release_point {
+        shared_source& self;
+        waiter*& served;
+        constexpr bool await_ready() const noexcept { return false; }
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<> h) const {
+            // the pump may be restarted once released, so nothing in its
+            // frame can be touched after that
+            auto w = std::exchange(served, nullptr);
+            if (!self.try_release()) { served = w; return h; }
+            return w ? w->handle : std::noop_coroutine();
+        }
+        constexpr void await_resume() const noexcept {}
+    };
+
+    static crt::agent pump(shared_source& self) noexcept {
+        waiter* served = nullptr;
+        while (true) {
+            auto w = self.take();
+            if (!w) { co_await release_point{self, served}; continue; }
+            if (served) { std::exchange(served, nullptr)->handle.resume(); }
+            while (w->count < w->capacity && !self.ended.load(relaxed)) {
+                co_await self.source;
+                if (self.source.done()) {
+                    self.ended.store(true, release);
+                    // rethrows exception of the generator
+                    if (self.source != std::default_sentinel) try {
+                        (void)*self.source;
+                    } catch (...) { w->error = std::current_exception(); }
+                    break;
+                }
+                w->put(self.source.take());
+            }
+            served = w;
+        }
+    }
+
+    std::coroutine_handle<> enqueue(waiter& w) {
+        auto top = state.load(relaxed);
+        while (true) {
+            if (top == IDLE) {
+                if (state.compare_exchange_weak(top, BUSY, acquire, relaxed))
+                    { fifo = &w; return pump_handle; }
+            } else {
+                w.next = reinterpret_cast<waiter*>(top);
+                auto desired = reinterpret_cast<std::uintptr_t>(&w);
+                if (state.compare_exchange_weak(top, desired, release, relaxed))
+                    { return std::noop_coroutine(); }
+            }
+        }
+    }
+
+    template <typename Derived>
+    struct pull_base {
+        shared_source& self;
+        waiter node;
+        bool await_ready() const noexcept { return self.ended.load(acquire); }
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<> h)
+            { node.handle = h; return self.enqueue(node); }
+        decltype(auto) await_resume() {
+            if (node.error) { std::rethrow_exception(node.error); }
+            return static_cast<Derived&>(*this).result();
+        }
+    };
+
+public:
+    shared_source(G&& gen):
+        source(gen.begin()), pump_handle(pump(*this).handle) {}
+    ~shared_source() { pump_handle.destroy(); }
+
+    shared_source(const shared_source&) = delete;
+    shared_source& operator=(const shared_source&) = delete;
+
+    class next_awaiter : public pull_base<next_awaiter> {
+        std::optional<value_type> item;
+    public:
+        next_awaiter(shared_source& self) : pull_base<next_awaiter>{self, {}}
+            { this->node.single = &item; }
+        next_awaiter(next_awaiter&& other) : next_awaiter(other.self) {}
+        std::optional<value_type> result() { return std::move(item); }
+    };
+
+    class batch_awaiter : public pull_base<batch_awaiter> {
+    public:
+        batch_awaiter(shared_source& self, std::span<value_type> out):
+            pull_base<batch_awaiter>{self, {}} {
+            this->node.batch = out;
+            this->node.capacity = out.size();
+        }
+        batch_awaiter(batch_awaiter&& other):
+            batch_awaiter(other.self, other.node.batch) {}
+        std::size_t result() const noexcept { return this->node.count; }
+    };
+
+    /**
+     * @brief Pulls one item.
+     */
+    next_awaiter next() { return next_awaiter(*this); }
+
+    /**
+     * @brief Pulls up to `out.size()` items into `out`.
+     *
+     * The request is filled before its consumer is resumed, unless the
+     * generator returns first.
+     */
+    batch_awaiter next_batch(std::span<value_type> out)
+        { return batch_awaiter(*this, out); }
+};
+
+template <typename G>
+shared_source(G&&) -> shared_source<G>;
+
+} // namespace coutils
+
+#endif // __COUTILS_SHARED_SOURCE__
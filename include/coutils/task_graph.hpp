@@ -0,0 +1,293 @@
+#pragma once
+#ifndef __COUTILS_TASK_GRAPH__
+#define __COUTILS_TASK_GRAPH__
+
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <utility>
+#include <algorithm>
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include <stdexcept>
+#include "coutils/utility.hpp"
+#include "coutils/executor.hpp"
+#include "coutils/task_group.hpp"
+#include "coutils/crt/async_fn.hpp"
+
+namespace coutils {
+
+/**
+ * @brief A reusable graph of async functions, each started once all of its
+ *        predecessors finish.
+ *
+ * Nodes are added with `add(fn, cost)`, where `fn()` gives a
+ * `crt::async_fn<void>`, and ordered with `precede(before, after)`. Every
+ * node has an atomic counter of unfinished predecessors, and the node
+ * finishing last of them makes it ready, so there are no barriers between
+ * levels of the graph.
+ *
+ * `co_await g.run(ex, workers)` runs the graph on `ex` with at most `workers`
+ * nodes running at a time. Ready nodes wait in a heap ordered by their
+ * critical path, the largest total cost of a path from the node to the end of
+ * the graph, so chains limiting the length of the whole run are started first.
+ *
+ * After a node throws, no more nodes are started, and the first exception is
+ * rethrown by `run` once running nodes finish. A graph must outlive awaiting
+ * `run`, must not be run again before that, and must not be changed while
+ * running.
+ *
+ * Critical paths, counters and the heap are allocated on the first run after
+ * the graph is changed, and reused by later runs. Besides calls of nodes, a
+ * run allocates the frame of `run`, a frame per worker and the slots of a
+ * `task_group` spawning workers.
+ */
+class task_graph {
+public:
+    using node_id = std::size_t;
+    static constexpr node_id npos = node_id(-1);
+
+private:
+    struct node {
+        std::function<crt::async_fn<void>()> fn;
+        std::uint64_t cost;
+        std::vector<node_id> successors = {};
+        std::size_t predecessors = 0;
+    };
+
+    std::vector<node> nodes;
+    // derived from `nodes` by `prepare`
+    bool prepared = false;
+    std::vector<std::uint64_t> critical;
+    std::unique_ptr<std::atomic<std::size_t>[]> pending;
+    std::vector<node_id> ready;
+
+    bool less_critical(node_id a, node_id b) const noexcept
+        { return critical[a] != critical[b] ? critical[a] < critical[b] : a > b; }
+
+    void push_ready(node_id id) {
+        ready.push_back(id);
+        std::push_heap(ready.begin(), ready.end(), [this](node_id a, node_id b) { return less_critical(a, b); });
+    }
+
+    node_id pop_ready() {
+        std::pop_heap(ready.begin(), ready.end(), [this](node_id a, node_id b) { return less_critical(a, b); });
+        auto id = ready.back();
+        ready.pop_back();
+        return id;
+    }
+
+    /**
+     * @brief Computes critical paths in reverse topological order.
+     */
+    void prepare() {
+        if (prepared) { return; }
+        auto n = nodes.size();
+        std::vector<std::size_t> indegree(n);
+        std::vector<node_id> order;
+        order.reserve(n);
+        for (node_id i = 0; i < n; ++i) {
+            indegree[i] = nodes[i].predecessors;
+            if (indegree[i] == 0) { order.push_back(i); }
+        }
+        for (std::size_t i = 0; i < order.size(); ++i) {
+            for (auto next : nodes[order[i]].successors)
+                { if (--indegree[next] == 0) { order.push_back(next); } }
+        }
+        if (order.size() != n) { throw std::logic_error("task graph has a cycle"); }
+        critical.assign(n, 0);
+        for (auto it = order.rbegin(); it != order.rend(); ++it) {
+            std::uint64_t longest = 0;
+            for (auto next : nodes[*it].successors) { longest = std::max(longest, critical[next]); }
+            critical[*it] = nodes[*it].cost + longest;
+        }
+        pending = std::make_unique<std::atomic<std::size_t>[]>(n);
+        ready.clear();
+        ready.reserve(n);
+        prepared = true;
+    }
+
+    struct run_state;
+
+    /**
+     * @brief Takes the most critical ready node, or parks until one is handed
+     *        over. Results in `npos` when the run ends.
+     */
+    class take_awaiter {
+        friend struct run_state;
+        run_state& st;
+        node_id got = npos;
+        take_awaiter* next = nullptr;
+        std::coroutine_handle<> handle;
+
+    public:
+        take_awaiter(run_state& st) : st(st) {}
+        take_awaiter(take_awaiter&& other) : st(other.st) {}
+
+        constexpr bool await_ready() const noexcept { return false; }
+        bool await_suspend(std::coroutine_handle<> h) {
+            auto guard = std::lock_guard(st.lock);
+            if (st.failed || st.remaining.load(std::memory_order::acquire) == 0) { return false; }
+            if (!st.graph.ready.empty()) { got = st.graph.pop_ready(); return false; }
+            handle = h;
+            next = std::exchange(st.parked, this);
+            return true;
+        }
+        node_id await_resume() const noexcept { return got; }
+    };
+
+    struct run_state {
+        task_graph& graph;
+        executor_ref ex;
+        default_lock lock;
+        take_awaiter* parked = nullptr;
+        std::atomic<std::size_t> remaining;
+        bool failed = false;
+        std::exception_ptr error;
+
+        run_state(task_graph& graph, executor_ref ex):
+            graph(graph), ex(ex), remaining(graph.nodes.size()) {}
+
+        void resume_all(take_awaiter* woken) {
+            while (woken) {
+                // a resumed worker may destroy its awaiter
+                auto next = woken->next;
+                auto h = woken->handle;
+                if (ex) { ex.post(h); } else { ops::resume_trampolined(h); }
+                woken = next;
+            }
+        }
+
+        // called with `lock` held, gets parked workers to be resumed
+        take_awaiter* hand_over() {
+            take_awaiter* woken = nullptr;
+            if (failed || remaining.load(std::memory_order::acquire) == 0) {
+                woken = std::exchange(parked, nullptr);
+            } else {
+                // leaves one ready node for the worker calling this
+                while (parked && graph.ready.size() > 1) {
+                    auto w = std::exchange(parked, parked->next);
+                    w->got = graph.pop_ready();
+                    w->next = std::exchange(woken, w);
+                }
+            }
+            return woken;
+        }
+
+        void complete(node_id id) {
+            for (auto next : graph.nodes[id].successors) {
+                if (graph.pending[next].fetch_sub(1, std::memory_order::acq_rel) != 1) { continue; }
+                take_awaiter* woken;
+                {
+                    auto guard = std::lock_guard(lock);
+                    graph.push_ready(next);
+                    woken = hand_over();
+                }
+                resume_all(woken);
+            }
+            if (remaining.fetch_sub(1, std::memory_order::acq_rel) == 1) {
+                take_awaiter* woken;
+                {
+                    auto guard = std::lock_guard(lock);
+                    woken = hand_over();
+                }
+                resume_all(woken);
+            }
+        }
+
+        void fail(std::exception_ptr e) {
+            take_awaiter* woken;
+            {
+                auto guard = std::lock_guard(lock);
+                if (!error) { error = std::move(e); }
+                failed = true;
+                woken = hand_over();
+            }
+            resume_all(woken);
+        }
+    };
+
+    static crt::async_fn<void> worker(task_graph& self, run_state& st) {
+        co_await _::post_to{st.ex};
+        while (true) {
+            auto id = co_await take_awaiter(st);
+            if (id == npos) { break; }
+            try {
+                co_await self.nodes[id].fn();
+                st.complete(id);
+            } catch (...) { st.fail(std::current_exception()); }
+        }
+    }
+
+public:
+    task_graph() = default;
+    task_graph(const task_graph&) = delete;
+    task_graph& operator=(const task_graph&) = delete;
+
+    std::size_t size() const noexcept { return nodes.size(); }
+
+    /**
+     * @brief Adds a node running `fn()` with `cost` counted in critical paths,
+     *        and gets its id.
+     */
+    template <typename F>
+    node_id add(F&& fn, std::uint64_t cost = 1) {
+        static_assert(std::is_convertible_v<std::invoke_result_t<F&>, crt::async_fn<void>>,
+            "nodes of a task graph should give crt::async_fn<void>");
+        nodes.push_back(node{COUTILS_FWD(fn), cost});
+        prepared = false;
+        return nodes.size() - 1;
+    }
+
+    /**
+     * @brief Makes node `after` start only after node `before` finishes.
+     */
+    void precede(node_id before, node_id after) {
+        if (before >= nodes.size() || after >= nodes.size())
+            { throw std::out_of_range("no such node in task graph"); }
+        nodes[before].successors.push_back(after);
+        ++nodes[after].predecessors;
+        prepared = false;
+    }
+
+    /**
+     * @brief Gets the critical path of node `id`, including its own cost.
+     *
+     * Throws `std::logic_error` when the graph has a cycle.
+     */
+    std::uint64_t critical_path(node_id id) { prepare(); return critical[id]; }
+
+    /**
+     * @brief Runs all nodes on `ex` with at most `workers` running at a time,
+     *        one per hardware thread when 0.
+     *
+     * Throws `std::logic_error` when the graph has a cycle.
+     */
+    crt::async_fn<void> run(executor_ref ex, std::size_t workers = 0) {
+        prepare();
+        if (nodes.empty()) { co_return; }
+        if (workers == 0) { workers = std::max(std::thread::hardware_concurrency(), 1u); }
+        workers = std::min(workers, nodes.size());
+        ready.clear();
+        for (node_id i = 0; i < nodes.size(); ++i) {
+            pending[i].store(nodes[i].predecessors, std::memory_order::relaxed);
+            if (nodes[i].predecessors == 0) { push_ready(i); }
+        }
+        run_state st(*this, ex);
+        {
+            task_group group(workers);
+            for (std::size_t i = 0; i < workers; ++i)
+                { co_await group.spawn(worker(*this, st)); }
+            co_await group.join();
+        }
+        if (st.error) { std::rethrow_exception(st.error); }
+    }
+};
+
+} // namespace coutils
+
+#endif // __COUTILS_TASK_GRAPH__
@@ -0,0 +1,241 @@
+#pragma once
+#ifndef __COUTILS_TASK_GROUP__
+#define __COUTILS_TASK_GROUP__
+
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <exception>
+#include <stop_token>
+#include "coutils/utility.hpp"
+#include "coutils/relay.hpp"
+#include "coutils/crt/async_fn.hpp"
+
+namespace coutils {
+
+/**
+ * @brief Exception holding all exceptions thrown by children of a group.
+ */
+class aggregate_error : public std::exception {
+    std::vector<std::exception_ptr> _errors;
+
+public:
+    explicit aggregate_error(std::vector<std::exception_ptr> errors):
+        _errors(std::move(errors)) {}
+
+    const std::vector<std::exception_ptr>& errors() const noexcept
+        { return _errors; }
+
+    const char* what() const noexcept override
+        { return "one or more tasks in group failed"; }
+};
+
+/**
+ * @brief A nursery running dynamically spawned async functions with bounded
+ *        concurrency.
+ *
+ * Children are started with `co_await group.spawn(fn())`, which starts the
+ * child inline on the spawning thread when a slot is free, and otherwise
+ * suspends the spawner until a running child finishes. The result of
+ * `spawn` tells whether the child is started, children spawned after the
+ * group is cancelled are dropped without being started. Results of children
+ * are discarded.
+ *
+ * `co_await group.join()` suspends until all started children finish, then
+ * throws `aggregate_error` if any of them threw. The first exception
+ * requests stop on the stop token of the group, which children can observe
+ * through `get_stop_token()` for cooperative cancellation.
+ *
+ * A finishing child resumes the spawner waiting for its slot, or the joiner
+ * when it is the last one, on the thread it finishes on.
+ *
+ * The group must be joined before destroyed. Slots and their relay
+ * coroutines are allocated once on construction, so spawning a child
+ * allocates nothing beyond the frame of the child.
+ */
+class task_group {
+    static constexpr std::size_t npos = std::size_t(-1);
+
+    using _Reaper = void (*)(std::coroutine_handle<>, std::exception_ptr&);
+
+    struct slot {
+        std::coroutine_handle<> child;
+        _Reaper reap = nullptr;
+        std::size_t next_free = npos;
+    };
+
+    struct waiter {
+        waiter* next = nullptr;
+        std::coroutine_handle<> handle;
+        std::size_t slot = npos;
+    };
+
+    default_lock lock;
+    std::size_t width;
+    std::unique_ptr<slot[]> slots;
+    std::size_t free_head = 0, running = 0;
+    waiter* wait_head = nullptr;
+    waiter* wait_tail = nullptr;
+    std::coroutine_handle<> joiner;
+    std::vector<std::exception_ptr> errors;
+    std::stop_source stop;
+    _::relay_group<task_group> relays;
+
+    template <typename T>
+    static void reap(std::coroutine_handle<> h, std::exception_ptr& error) {
+        using enum crt::promise_state;
+        auto child = owning_handle<crt::async_fn_promise<T>>(
+            handle_cast<crt::async_fn_promise<T>>(h));
+        auto& p = child.promise();
+        if (p.status() == ERROR) { error = p.get_error(); }
+    }
+
+    // Following members should be accessed with `lock` held.
+
+    std::size_t acquire() {
+        auto id = free_head;
+        if (id != npos) { free_head = slots[id].next_free; ++running; }
+        return id;
+    }
+
+    std::coroutine_handle<> release(std::size_t id) {
+        if (wait_head) {
+            auto w = std::exchange(wait_head, wait_head->next);
+            if (!wait_head) { wait_tail = nullptr; }
+            w->slot = id;
+            return w->handle;
+        }
+        slots[id].next_free = std::exchange(free_head, id);
+        if (--running == 0) { return std::exchange(joiner, nullptr); }
+        return nullptr;
+    }
+
+    template <typename T>
+    void start(std::size_t id, crt::async_fn<T>&& fn) {
+        auto child = fn.release();
+        child.promise().caller = relays[id];
+        slots[id].child = child;
+        slots[id].reap = &reap<T>;
+        child.resume();
+    }
+
+    void drop(std::size_t id) {
+        std::coroutine_handle<> next;
+        {
+            auto guard = std::lock_guard(lock);
+            next = release(id);
+        }
+        if (next) { next.resume(); }
+    }
+
+    friend struct _::relay_point<task_group>;
+
+    std::coroutine_handle<> complete(std::size_t id) {
+        std::exception_ptr error;
+        auto& s = slots[id];
+        s.reap(std::exchange(s.child, nullptr), error);
+        bool first_error = false;
+        std::coroutine_handle<> next;
+        {
+            auto guard = std::lock_guard(lock);
+            if (error) {
+                first_error = errors.empty();
+                errors.push_back(std::move(error));
+            }
+            next = release(id);
+        }
+        if (first_error) { stop.request_stop(); }
+        return next;
+    }
+
+public:
+    explicit task_group(std::size_t max_concurrency):
+        width(max_concurrency ? max_concurrency : 1),
+        slots(std::make_unique<slot[]>(width)), relays(*this, width) {
+        for (std::size_t i = 0; i + 1 < width; ++i) { slots[i].next_free = i + 1; }
+    }
+
+    task_group(const task_group&) = delete;
+    task_group& operator=(const task_group&) = delete;
+
+    std::size_t max_concurrency() const noexcept { return width; }
+
+    std::stop_token get_stop_token() const noexcept { return stop.get_token(); }
+    bool request_stop() noexcept { return stop.request_stop(); }
+
+    template <typename T>
+    class spawn_awaiter {
+        task_group& group;
+        crt::async_fn<T> fn;
+        waiter node;
+
+    public:
+        spawn_awaiter(task_group& group, crt::async_fn<T>&& fn):
+            group(group), fn(std::move(fn)) {}
+        spawn_awaiter(spawn_awaiter&& other):
+            group(other.group), fn(std::move(other.fn)) {}
+
+        bool await_ready() const noexcept
+            { return group.stop.stop_requested(); }
+
+        bool await_suspend(std::coroutine_handle<> h) {
+            auto guard = std::lock_guard(group.lock);
+            node.slot = group.acquire();
+            if (node.slot != npos) { return false; }
+            node.handle = h;
+            if (group.wait_tail) { group.wait_tail->next = &node; }
+            else { group.wait_head = &node; }
+            group.wait_tail = &node;
+            return true;
+        }
+
+        bool await_resume() {
+            if (node.slot == npos) { return false; }
+            if (group.stop.stop_requested())
+                { group.drop(node.slot); return false; }
+            group.start(node.slot, std::move(fn));
+            return true;
+        }
+    };
+
+    class join_awaiter {
+        task_group& group;
+
+    public:
+        join_awaiter(task_group& group) : group(group) {}
+
+        constexpr bool await_ready() const noexcept { return false; }
+
+        bool await_suspend(std::coroutine_handle<> h) {
+            auto guard = std::lock_guard(group.lock);
+            if (group.running == 0) { return false; }
+            group.joiner = h;
+            return true;
+        }
+
+        void await_resume() {
+            std::vector<std::exception_ptr> errors;
+            {
+                auto guard = std::lock_guard(group.lock);
+                errors.swap(group.errors);
+            }
+            if (!errors.empty()) { throw aggregate_error(std::move(errors)); }
+        }
+    };
+
+    /**
+     * @brief Starts `fn` as a child, waiting for a free slot if needed.
+     */
+    template <typename T>
+    spawn_awaiter<T> spawn(crt::async_fn<T>&& fn)
+        { return spawn_awaiter<T>(*this, std::move(fn)); }
+
+    /**
+     * @brief Waits for all started children.
+     */
+    join_awaiter join() { return join_awaiter(*this); }
+};
+
+} // namespace coutils
+
+#endif // __COUTILS_TASK_GROUP__
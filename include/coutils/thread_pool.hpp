@@ -0,0 +1,97 @@
+#pragma once
+#ifndef __COUTILS_THREAD_POOL__
+#define __COUTILS_THREAD_POOL__
+
+#include <mutex>
+#include <deque>
+#include <thread>
+#include <vector>
+#include <coroutine>
+#include <condition_variable>
+#include "coutils/executor.hpp"
+
+namespace coutils {
+
+/**
+ * @brief A fixed set of worker threads resuming posted coroutines in FIFO
+ *        order.
+ *
+ * Workers set the pool as their `current_executor()`. Move the awaiting
+ * coroutine onto the pool with `co_await pool.schedule()`.
+ *
+ * Destroying the pool waits until coroutines already posted are resumed and
+ * workers exit, so nothing should be posted to it at that time.
+ */
+class thread_pool {
+    std::mutex lock;
+    std::condition_variable cv;
+    std::deque<std::coroutine_handle<>> queue;
+    bool stopping = false;
+    std::vector<std::thread> workers;
+
+    void run() {
+        auto scope = _::executor_scope(*this);
+        while (true) {
+            std::coroutine_handle<> h;
+            {
+                auto guard = std::unique_lock(lock);
+                cv.wait(guard, [&] { return stopping || !queue.empty(); });
+                if (queue.empty()) { return; }
+                h = queue.front(); queue.pop_front();
+            }
+            h.resume();
+        }
+    }
+
+public:
+    explicit thread_pool(std::size_t n = std::thread::hardware_concurrency()) {
+        if (n == 0) { n = 1; }
+        workers.reserve(n);
+        for (std::size_t i = 0; i < n; ++i)
+            { workers.emplace_back([this] { run(); }); }
+    }
+
+    ~thread_pool() {
+        {
+            auto guard = std::lock_guard(lock);
+            stopping = true;
+        }
+        cv.notify_all();
+        for (auto&& w : workers) { w.join(); }
+    }
+
+    thread_pool(const thread_pool&) = delete;
+    thread_pool& operator=(const thread_pool&) = delete;
+
+    std::size_t size() const noexcept { return workers.size(); }
+
+    void post(std::coroutine_handle<> h) {
+        // notify with lock held, so that the pool cannot be destroyed by the
+        // posted coroutine before this returns
+        auto guard = std::lock_guard(lock);
+        queue.push_back(h);
+        cv.notify_one();
+    }
+
+    bool running_in_this_thread() const noexcept
+        { return current_executor().address() == this; }
+
+    class schedule_awaiter {
+        thread_pool& pool;
+
+    public:
+        schedule_awaiter(thread_pool& pool) : pool(pool) {}
+        constexpr bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> h) const { pool.post(h); }
+        constexpr void await_resume() const noexcept {}
+    };
+
+    /**
+     * @brief Resumes the awaiting coroutine on a worker.
+     */
+    schedule_awaiter schedule() { return schedule_awaiter(*this); }
+};
+
+} // namespace coutils
+
+#endif // __COUTILS_THREAD_POOL__
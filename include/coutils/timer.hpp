@@ -0,0 +1,149 @@
+#pragma once
+#ifndef __COUTILS_TIMER__
+#define __COUTILS_TIMER__
+
+#include <map>
+#include <mutex>
+#include <chrono>
+#include <thread>
+#include <cstdint>
+#include <coroutine>
+#include <condition_variable>
+#include "coutils/executor.hpp"
+
+namespace coutils {
+
+/**
+ * @brief A thread resuming coroutines at given times.
+ *
+ * A coroutine due is posted to the executor it was queued with, or resumed
+ * on the timer thread when that is null, so it should not run long there.
+ * Timers are kept in a `std::map`, which allocates a node per timer.
+ *
+ * Destroying the queue drops pending timers without resuming them, so nothing
+ * should be waiting on it at that time.
+ */
+class timer_queue {
+public:
+    using clock = std::chrono::steady_clock;
+
+    /**
+     * @brief Identifies a queued timer, for `cancel`.
+     */
+    struct timer_id {
+        clock::time_point when;
+        std::uint64_t seq;
+        auto operator<=>(const timer_id&) const = default;
+    };
+
+private:
+    struct entry {
+        std::coroutine_handle<> handle;
+        executor_ref ex;
+    };
+
+    std::mutex lock;
+    std::condition_variable cv;
+    std::map<timer_id, entry> timers;
+    std::uint64_t queued = 0;
+    bool stopping = false;
+    std::thread thread;
+
+    void run() {
+        auto guard = std::unique_lock(lock);
+        while (!stopping) {
+            if (timers.empty()) { cv.wait(guard); continue; }
+            auto first = timers.begin();
+            // copied, since the timer may be cancelled while waiting
+            auto when = first->first.when;
+            if (clock::now() < when) { cv.wait_until(guard, when); continue; }
+            auto e = first->second;
+            timers.erase(first);
+            guard.unlock();
+            if (e.ex) { e.ex.post(e.handle); } else { e.handle.resume(); }
+            guard.lock();
+        }
+    }
+
+public:
+    timer_queue() : thread([this] { run(); }) {}
+
+    ~timer_queue() {
+        {
+            auto guard = std::lock_guard(lock);
+            stopping = true;
+        }
+        cv.notify_one();
+        thread.join();
+    }
+
+    timer_queue(const timer_queue&) = delete;
+    timer_queue& operator=(const timer_queue&) = delete;
+
+    /**
+     * @brief Queues `h` to be resumed on `ex` at `when`.
+     */
+    timer_id post_at(clock::time_point when, std::coroutine_handle<> h, executor_ref ex = {}) {
+        auto guard = std::lock_guard(lock);
+        timer_id id{when, queued++};
+        bool earliest = timers.empty() || id < timers.begin()->first;
+        timers.emplace(id, entry{h, ex});
+        if (earliest) { cv.notify_one(); }
+        return id;
+    }
+
+    /**
+     * @brief Removes a queued timer, gets false when it is already due.
+     */
+    bool cancel(const timer_id& id) {
+        auto guard = std::lock_guard(lock);
+        return timers.erase(id) != 0;
+    }
+
+    class sleep_awaiter {
+        timer_queue& queue;
+        clock::time_point when;
+        executor_ref ex;
+
+    public:
+        sleep_awaiter(timer_queue& queue, clock::time_point when, executor_ref ex):
+            queue(queue), when(when), ex(ex) {}
+
+        bool await_ready() const { return when <= clock::now(); }
+        void await_suspend(std::coroutine_handle<> h)
+            { queue.post_at(when, h, ex ? ex : current_executor()); }
+        constexpr void await_resume() const noexcept {}
+    };
+
+    /**
+     * @brief Resumes the awaiting coroutine at `when` on `ex`, or on the
+     *        executor running it when `ex` is null.
+     */
+    sleep_awaiter sleep_until(clock::time_point when, executor_ref ex = {})
+        { return sleep_awaiter(*this, when, ex); }
+
+    /**
+     * @brief Resumes the awaiting coroutine after `d` on `ex`, or on the
+     *        executor running it when `ex` is null.
+     */
+    sleep_awaiter sleep_for(clock::duration d, executor_ref ex = {})
+        { return sleep_awaiter(*this, clock::now() + d, ex); }
+};
+
+/**
+ * @brief The timer queue used when none is given, created on first use.
+ */
+inline timer_queue& default_timer() {
+    static timer_queue timer;
+    return timer;
+}
+
+inline timer_queue::sleep_awaiter sleep_until(timer_queue::clock::time_point when, executor_ref ex = {})
+    { return default_timer().sleep_until(when, ex); }
+
+inline timer_queue::sleep_awaiter sleep_for(timer_queue::clock::duration d, executor_ref ex = {})
+    { return default_timer().sleep_for(d, ex); }
+
+} // namespace coutils
+
+#endif // __COUTILS_TIMER__
@@ -2,6 +2,7 @@
 #ifndef __COUTILS_TRAITS__
 #define __COUTILS_TRAITS__
 
+#include <deque>
 #include <coroutine>
 #include <type_traits>
 #include "coutils/macros.hpp"
@@ -117,15 +118,49 @@ static inline bool await_suspend(T&& awaiter, std::coroutine_handle<> caller) {
     }
 }
 
+namespace _ {
+
+struct trampoline_state {
+    std::deque<std::coroutine_handle<>> pending;
+    bool draining = false;
+};
+
+inline thread_local trampoline_state trampoline = {};
+
+} // namespace _
+
+/**
+ * @brief Resumes `h` through a thread local trampoline.
+ *
+ * When called during another trampolined resumption on the same thread, `h`
+ * is queued and resumed by the outermost one after the current one returns,
+ * so chains of synchronous completions do not nest on the native stack.
+ */
+static inline void resume_trampolined(std::coroutine_handle<> h) {
+    auto& state = _::trampoline;
+    if (state.draining) { state.pending.push_back(h); return; }
+    state.draining = true;
+    struct reset {
+        _::trampoline_state& state;
+        ~reset() { state.draining = false; }
+    } guard{state};
+    h.resume();
+    while (!state.pending.empty()) {
+        auto next = state.pending.front();
+        state.pending.pop_front();
+        next.resume();
+    }
+}
+
 template <traits::awaiter T>
 static inline void await_launch(T&& awaiter, std::coroutine_handle<> caller) {
-    if (!await_suspend(COUTILS_FWD(awaiter), caller)) { caller.resume(); }
+    if (!await_suspend(COUTILS_FWD(awaiter), caller)) { resume_trampolined(caller); }
 }
 
 template <traits::awaiter T>
 static inline decltype(auto) await_resume(T&& awaiter) {
     if constexpr (std::is_void_v<traits::await_resume_t<T>>)
-        { return std::monostate{}; }
+        { awaiter.await_resume(); return std::monostate{}; }
     else { return awaiter.await_resume(); }
 }
 
@@ -8,8 +8,10 @@
 #include <atomic>
 #include <memory>
 #include <coroutine>
+#include <source_location>
 #include "coutils/macros.hpp"
 #include "coutils/traits.hpp"
+#include "coutils/locks.hpp"
 
 namespace coutils {
 
@@ -50,6 +52,19 @@ public:
     auto ref() noexcept { return empty_lock(); }
 };
 
+/**
+ * @brief The lock guarding internal state of `task_group`, `broadcast`,
+ *        `completion_queue` and `as_completed`.
+ *
+ * `light_lock` unless `COUTILS_DEFAULT_LOCK` is defined as another lock type,
+ * like `coutils::adaptive_lock`.
+ */
+#ifdef COUTILS_DEFAULT_LOCK
+using default_lock = COUTILS_DEFAULT_LOCK;
+#else
+using default_lock = light_lock;
+#endif
+
 
 /**
  * @brief An awaitable that transfers control to another handle.
@@ -74,6 +89,14 @@ struct transfer_to_handle {
 template <typename Returned, typename Promise>
     requires (std::is_constructible_v<Returned, Promise&>)
 struct promise_bridge : public Promise {
+    promise_bridge()
+        requires (!std::is_constructible_v<Promise, std::source_location>) = default;
+    // Default argument here is evaluated in the coroutine, so that promises
+    // taking a `std::source_location` get the location of the coroutine.
+    promise_bridge(std::source_location loc = std::source_location::current())
+        requires (std::is_constructible_v<Promise, std::source_location>) :
+        Promise(loc) {}
+
     constexpr decltype(auto) get_return_object()
         noexcept(std::is_nothrow_constructible_v<Returned, Promise&>)
         { return Returned(static_cast<Promise&>(*this)); }
@@ -20,7 +20,12 @@ class ref {
     std::remove_reference_t<R>* ptr;
 public:
     using type = R;
-    template <typename T> requires std::is_convertible_v<T&&, R>
+    // excludes `ref` itself, which converts to `R` and would be wrapped again
+    // instead of copied
+    template <typename T> requires (
+        !std::is_same_v<std::remove_cvref_t<T>, ref> &&
+        std::is_convertible_v<T&&, R>
+    )
     ref(T&& t) noexcept : ptr(std::addressof(t)) {}
     ref(const ref&) = default;
     ref& operator=(const ref&) = default;
@@ -37,7 +42,10 @@ class optref {
 public:
     using type = R;
     optref() noexcept : ptr(nullptr) {}
-    template <typename T> requires std::is_convertible_v<T&&, R>
+    template <typename T> requires (
+        !std::is_same_v<std::remove_cvref_t<T>, optref> &&
+        std::is_convertible_v<T&&, R>
+    )
     optref(T&& t) noexcept : ptr(std::addressof(t)) {}
     optref(const optref&) = default;
     optref& operator=(const optref&) = default;
@@ -2,7 +2,8 @@
 #ifndef __COUTILS_WAIT__
 #define __COUTILS_WAIT__
 
-#include <atomic>
+#include <mutex>
+#include <condition_variable>
 #include "coutils/crt/agent.hpp"
 #include "coutils/traits.hpp"
 
@@ -17,17 +18,28 @@ template <traits::awaitable T>
 static inline decltype(auto) wait(T&& awaitable) {
     auto&& awaiter = ops::get_awaiter(COUTILS_FWD(awaitable));
     {
-        using enum std::memory_order;
-        std::atomic_flag completed;
+        // notified with the lock held, so that this cannot return (and free
+        // these) before the notifying thread stops touching them
+        std::mutex lock;
+        std::condition_variable cv;
+        bool completed = false;
         auto set_flag = [&]() -> crt::agent {
-            completed.test_and_set(release);
-            completed.notify_all(); co_return;
+            auto guard = std::lock_guard(lock);
+            completed = true;
+            cv.notify_all(); co_return;
         };
+        auto flag_setter = set_flag().handle;
         bool suspended = ops::await_suspend(
             COUTILS_FWD(awaiter),
-            set_flag().handle
+            flag_setter
         );
-        if (suspended) { completed.wait(false, acquire); }
+        if (suspended) {
+            auto guard = std::unique_lock(lock);
+            cv.wait(guard, [&] { return completed; });
+        } else {
+            // never started, so it is not destroyed by itself
+            flag_setter.destroy();
+        }
     }
     return awaiter.await_resume();
 }
@@ -0,0 +1,687 @@
+#pragma once
+#ifndef __COUTILS_WINDOW__
+#define __COUTILS_WINDOW__
+
+#include <list>
+#include <mutex>
+#include <chrono>
+#include <memory>
+#include <vector>
+#include <utility>
+#include <optional>
+#include <coroutine>
+#include <stdexcept>
+#include <functional>
+#include <type_traits>
+#include <unordered_map>
+#include "coutils/utility.hpp"
+#include "coutils/traits.hpp"
+#include "coutils/executor.hpp"
+#include "coutils/timer.hpp"
+#include "coutils/relay.hpp"
+#include "coutils/multi_stream.hpp"
+#include "coutils/crt/agent.hpp"
+#include "coutils/crt/async_generator.hpp"
+
+namespace coutils {
+
+/**
+ * @brief An aggregate of a window, with the number of items in it.
+ *
+ * `start` and `end` are the bounds of the window for windows of a duration,
+ * and the arrival times of its first and last items for windows of a count.
+ */
+template <typename R>
+struct window_result {
+    R value;
+    std::size_t count;
+    timer_queue::clock::time_point start, end;
+};
+
+/**
+ * @brief An aggregate folding items into a value with an associative `op`,
+ *        starting from its `identity`.
+ *
+ * Window operators take any aggregate with the same members: `init()` gives
+ * an empty state, `add(state, item)` adds an item to it, `merge(state, other)`
+ * appends the items of another state to it (only needed by sliding windows),
+ * and `result(state)` gives what is emitted.
+ */
+template <typename T, typename Op = std::plus<>>
+struct fold_aggregate {
+    T identity;
+    Op op = {};
+
+    T init() const { return identity; }
+    void add(T& acc, const auto& item) const { acc = std::invoke(op, std::move(acc), item); }
+    void merge(T& acc, const T& other) const { acc = std::invoke(op, std::move(acc), other); }
+    T result(const T& acc) const { return acc; }
+};
+
+template <typename T, typename Op>
+fold_aggregate(T, Op) -> fold_aggregate<T, Op>;
+
+namespace _ {
+
+using window_clock = timer_queue::clock;
+
+template <typename A>
+using aggregate_state_t = std::remove_cvref_t<decltype(std::declval<const A&>().init())>;
+
+template <typename A>
+using aggregate_result_t = std::remove_cvref_t<decltype(
+    std::declval<const A&>().result(std::declval<const aggregate_state_t<A>&>()))>;
+
+inline window_clock::time_point window_floor(window_clock::time_point t, window_clock::duration width)
+    { return t - t.time_since_epoch() % width; }
+
+enum class pulled { item, timeout, end };
+
+/**
+ * @brief Pulls items of an async generator, giving up waiting for one at a
+ *        deadline.
+ *
+ * The source is resumed by a relay, and the deadline is kept by a timer of
+ * `default_timer()`, so whichever comes first resumes the puller. A pull given
+ * up on is not cancelled, the next one waits for the same item. An earlier
+ * deadline replaces the timer, and a later one is armed when the timer fires,
+ * so timeouts may come before the deadline and should be checked.
+ *
+ * The puller is resumed on the thread of the source when an item arrives, and
+ * on the executor running it when it suspended when the timer fires.
+ */
+template <typename G>
+class timed_source {
+    struct state : std::enable_shared_from_this<state> {
+        stream_iterator<G> source;
+        crt::agent_handle relay_handle;
+        // only accessed by the puller
+        bool pulling = false;
+
+        default_lock lock;
+        bool arrived = false, fired = false, closed = false;
+        std::coroutine_handle<> waiter;
+        executor_ref ex;
+        // the pending timer, if any
+        std::optional<timer_queue::timer_id> armed;
+        std::coroutine_handle<> ticker;
+
+        state(G&& gen) : source(gen.begin()), relay_handle(relay(*this, 0).handle) {}
+        ~state() { relay_handle.destroy(); }
+
+        std::coroutine_handle<> complete(std::size_t) {
+            auto guard = std::lock_guard(lock);
+            arrived = true;
+            return std::exchange(waiter, nullptr);
+        }
+
+        struct at_time {
+            state& self;
+            window_clock::time_point when;
+            constexpr bool await_ready() const noexcept { return false; }
+            bool await_suspend(std::coroutine_handle<> h) {
+                auto guard = std::lock_guard(self.lock);
+                if (self.closed) { return false; }
+                self.ticker = h;
+                self.armed = default_timer().post_at(when, h);
+                return true;
+            }
+            constexpr void await_resume() const noexcept {}
+        };
+
+        static crt::agent tick(std::shared_ptr<state> self, window_clock::time_point when) noexcept {
+            co_await at_time{*self, when};
+            self->fire();
+        }
+
+        void fire() {
+            std::coroutine_handle<> w;
+            executor_ref wex;
+            {
+                auto guard = std::lock_guard(lock);
+                if (closed) { return; }
+                armed.reset();
+                ticker = nullptr;
+                fired = true;
+                w = std::exchange(waiter, nullptr);
+                wex = ex;
+            }
+            if (w) { _::dispatch(wex, w); }
+        }
+
+        void arm(window_clock::time_point when) {
+            {
+                auto guard = std::lock_guard(lock);
+                if (armed) {
+                    // a timer failing to cancel is firing, which is earlier
+                    if (armed->when <= when || !default_timer().cancel(*armed)) { return; }
+                    // never resumed, so its frame is dropped here
+                    std::exchange(ticker, nullptr).destroy();
+                    armed.reset();
+                }
+            }
+            tick(this->shared_from_this(), when).handle.resume();
+        }
+
+        void close() {
+            auto guard = std::lock_guard(lock);
+            closed = true;
+            if (armed && default_timer().cancel(*armed))
+                { std::exchange(ticker, nullptr).destroy(); }
+            armed.reset();
+        }
+    };
+
+    // the timer holds this while armed, so it is shared
+    std::shared_ptr<state> st;
+
+public:
+    explicit timed_source(G&& gen) : st(std::make_shared<state>(std::move(gen))) {}
+    ~timed_source() { st->close(); }
+
+    timed_source(const timed_source&) = delete;
+    timed_source& operator=(const timed_source&) = delete;
+
+    class next_awaiter {
+        state& st;
+        std::optional<window_clock::time_point> deadline;
+
+    public:
+        next_awaiter(state& st, std::optional<window_clock::time_point> deadline):
+            st(st), deadline(deadline) {}
+
+        constexpr bool await_ready() const noexcept { return false; }
+        bool await_suspend(std::coroutine_handle<> h) {
+            if (!st.pulling) {
+                st.pulling = true;
+                ops::await_launch(st.source, st.relay_handle);
+            }
+            if (deadline) { st.arm(*deadline); }
+            auto guard = std::lock_guard(st.lock);
+            if (st.arrived || st.fired) { return false; }
+            st.waiter = h;
+            st.ex = coutils::current_executor();
+            return true;
+        }
+        pulled await_resume() {
+            {
+                auto guard = std::lock_guard(st.lock);
+                if (!st.arrived) { st.fired = false; return pulled::timeout; }
+                st.arrived = false;
+            }
+            st.pulling = false;
+            if (!st.source.done()) { return pulled::item; }
+            if (st.source == std::default_sentinel) { return pulled::end; }
+            // rethrows exception of the source
+            (void)*st.source;
+            return pulled::end;
+        }
+    };
+
+    /**
+     * @brief Waits for the next item, or until `deadline` when given.
+     */
+    next_awaiter next(std::optional<window_clock::time_point> deadline)
+        { return next_awaiter(*st, deadline); }
+
+    /**
+     * @brief The item pulled last, valid until the next pull.
+     */
+    decltype(auto) item() { return *st->source; }
+};
+
+/**
+ * @brief Feeds items of `gen` to window state `win` and yields its outputs.
+ *
+ * `win` gives the time it should be woken at with `deadline()`, outputs due
+ * by a time with `due(now)`, the output completed by an item with
+ * `add(item, now)`, and outputs left at the end with `finish()`.
+ */
+template <typename Out, typename G, typename W>
+crt::async_generator<Out> run_windows(G gen, W win) {
+    timed_source<G> src(std::move(gen));
+    while (true) {
+        auto got = co_await src.next(win.deadline());
+        auto now = window_clock::now();
+        // windows ended before the item are closed first
+        while (auto out = win.due(now)) { co_yield std::move(*out); }
+        if (got == pulled::end) { break; }
+        if (got == pulled::item) {
+            if (auto out = win.add(src.item(), now)) { co_yield std::move(*out); }
+        }
+    }
+    while (auto out = win.finish()) { co_yield std::move(*out); }
+}
+
+/**
+ * @brief The state of a window being filled.
+ */
+template <typename A>
+struct window_pane {
+    std::optional<aggregate_state_t<A>> acc;
+    std::size_t count = 0;
+    window_clock::time_point first, last;
+
+    void add(const A& agg, auto&& item, window_clock::time_point now) {
+        if (count++ == 0) { acc.emplace(agg.init()); first = now; }
+        agg.add(*acc, item);
+        last = now;
+    }
+
+    window_result<aggregate_result_t<A>> take(const A& agg, window_clock::time_point start, window_clock::time_point end) {
+        window_result<aggregate_result_t<A>> out{agg.result(*acc), count, start, end};
+        acc.reset();
+        count = 0;
+        return out;
+    }
+};
+
+template <typename A>
+class count_tumbling {
+    using _Out = window_result<aggregate_result_t<A>>;
+    A agg;
+    std::size_t n;
+    window_clock::duration idle;
+    window_pane<A> pane;
+
+public:
+    count_tumbling(A agg, std::size_t n, window_clock::duration idle):
+        agg(std::move(agg)), n(n ? n : 1), idle(idle) {}
+
+    std::optional<window_clock::time_point> deadline() const {
+        if (pane.count == 0 || idle <= window_clock::duration::zero()) { return std::nullopt; }
+        return pane.last + idle;
+    }
+
+    std::optional<_Out> due(window_clock::time_point now) {
+        auto d = deadline();
+        if (!d || now < *d) { return std::nullopt; }
+        return finish();
+    }
+
+    std::optional<_Out> add(auto&& item, window_clock::time_point now) {
+        pane.add(agg, item, now);
+        if (pane.count < n) { return std::nullopt; }
+        return finish();
+    }
+
+    std::optional<_Out> finish() {
+        if (pane.count == 0) { return std::nullopt; }
+        return pane.take(agg, pane.first, pane.last);
+    }
+};
+
+template <typename A>
+class time_tumbling {
+    using _Out = window_result<aggregate_result_t<A>>;
+    A agg;
+    window_clock::duration width;
+    window_clock::time_point start;
+    window_pane<A> pane;
+
+public:
+    time_tumbling(A agg, window_clock::duration width) : agg(std::move(agg)), width(width) {}
+
+    std::optional<window_clock::time_point> deadline() const {
+        if (pane.count == 0) { return std::nullopt; }
+        return start + width;
+    }
+
+    std::optional<_Out> due(window_clock::time_point now) {
+        if (pane.count == 0 || now < start + width) { return std::nullopt; }
+        return finish();
+    }
+
+    std::optional<_Out> add(auto&& item, window_clock::time_point now) {
+        if (pane.count == 0) { start = window_floor(now, width); }
+        pane.add(agg, item, now);
+        return std::nullopt;
+    }
+
+    std::optional<_Out> finish() {
+        if (pane.count == 0) { return std::nullopt; }
+        return pane.take(agg, start, start + width);
+    }
+};
+
+/**
+ * @brief A sliding window kept as a ring of panes of one slide each, so that
+ *        an item is only added to one pane, and a window merges its panes.
+ */
+template <typename A>
+class pane_ring {
+    using _Out = window_result<aggregate_result_t<A>>;
+
+protected:
+    A agg;
+    std::vector<window_pane<A>> panes;
+    // the pane being filled, the newest of the window
+    std::size_t current = 0;
+    std::size_t live = 0;
+
+    pane_ring(A agg, std::size_t k) : agg(std::move(agg)), panes(k ? k : 1) {}
+
+    _Out merged() const {
+        std::optional<aggregate_state_t<A>> acc;
+        std::size_t count = 0;
+        window_clock::time_point first, last;
+        for (std::size_t i = 1; i <= panes.size(); ++i) {
+            // from the oldest pane to the newest one
+            auto& p = panes[(current + i) % panes.size()];
+            if (p.count == 0) { continue; }
+            if (!acc) { acc.emplace(*p.acc); first = p.first; }
+            else { agg.merge(*acc, *p.acc); }
+            count += p.count;
+            last = p.last;
+        }
+        return _Out{agg.result(*acc), count, first, last};
+    }
+
+    void rotate() {
+        current = (current + 1) % panes.size();
+        auto& p = panes[current];
+        live -= p.count;
+        p.acc.reset();
+        p.count = 0;
+    }
+};
+
+template <typename A>
+class count_sliding : pane_ring<A> {
+    using _Out = window_result<aggregate_result_t<A>>;
+    std::size_t slide;
+    window_clock::duration idle;
+    // whether the window was emitted since the last item
+    bool flushed = true;
+
+public:
+    count_sliding(A agg, std::size_t size, std::size_t slide, window_clock::duration idle):
+        pane_ring<A>(std::move(agg), slide ? size / slide : 0), slide(slide), idle(idle) {
+        if (slide == 0 || size == 0 || size % slide != 0)
+            { throw std::invalid_argument("size of a sliding window should be a multiple of its slide"); }
+    }
+
+    std::optional<window_clock::time_point> deadline() const {
+        if (flushed || idle <= window_clock::duration::zero()) { return std::nullopt; }
+        return this->panes[this->current].last + idle;
+    }
+
+    std::optional<_Out> due(window_clock::time_point now) {
+        auto d = deadline();
+        if (!d || now < *d) { return std::nullopt; }
+        return finish();
+    }
+
+    std::optional<_Out> add(auto&& item, window_clock::time_point now) {
+        auto& p = this->panes[this->current];
+        p.add(this->agg, item, now);
+        ++this->live;
+        flushed = false;
+        if (p.count < slide) { return std::nullopt; }
+        auto out = this->merged();
+        this->rotate();
+        flushed = true;
+        return out;
+    }
+
+    std::optional<_Out> finish() {
+        if (flushed) { return std::nullopt; }
+        flushed = true;
+        return this->merged();
+    }
+};
+
+template <typename A>
+class time_sliding : pane_ring<A> {
+    using _Out = window_result<aggregate_result_t<A>>;
+    window_clock::duration size, slide;
+    // start of the pane being filled
+    window_clock::time_point start;
+
+    _Out close() {
+        auto out = this->merged();
+        out.end = start + slide;
+        out.start = out.end - size;
+        return out;
+    }
+
+public:
+    time_sliding(A agg, window_clock::duration size, window_clock::duration slide):
+        pane_ring<A>(std::move(agg), slide.count() > 0 ? std::size_t(size / slide) : 0), size(size), slide(slide) {
+        if (slide <= window_clock::duration::zero() || size <= window_clock::duration::zero() || size % slide != window_clock::duration::zero())
+            { throw std::invalid_argument("size of a sliding window should be a multiple of its slide"); }
+    }
+
+    std::optional<window_clock::time_point> deadline() const {
+        if (this->live == 0) { return std::nullopt; }
+        return start + slide;
+    }
+
+    std::optional<_Out> due(window_clock::time_point now) {
+        if (this->live == 0 || now < start + slide) { return std::nullopt; }
+        auto out = close();
+        this->rotate();
+        start += slide;
+        return out;
+    }
+
+    std::optional<_Out> add(auto&& item, window_clock::time_point now) {
+        // panes are empty, so the ring restarts at the pane of `now`
+        if (this->live == 0) { start = window_floor(now, slide); }
+        this->panes[this->current].add(this->agg, item, now);
+        ++this->live;
+        return std::nullopt;
+    }
+
+    std::optional<_Out> finish() {
+        if (this->live == 0) { return std::nullopt; }
+        auto out = close();
+        for (auto& p : this->panes) { p.acc.reset(); p.count = 0; }
+        this->live = 0;
+        return out;
+    }
+};
+
+/**
+ * @brief Tumbling windows per key, of `n` items or of `width` when `n` is 0.
+ *
+ * Keys with a window being filled are listed from the least recently added
+ * to, so the first one is the next to go idle, and windows of a duration are
+ * emitted in the order their keys first got an item.
+ */
+template <typename K, typename F, typename A>
+class keyed_tumbling {
+    using _Out = std::pair<K, window_result<aggregate_result_t<A>>>;
+    struct slot {
+        window_pane<A> pane;
+        typename std::list<K>::iterator pos;
+    };
+
+    F key_fn;
+    A agg;
+    std::size_t n;
+    window_clock::duration width, idle;
+    window_clock::time_point start;
+    std::unordered_map<K, slot> slots;
+    std::list<K> order;
+
+    _Out take(typename std::unordered_map<K, slot>::iterator it) {
+        auto& pane = it->second.pane;
+        auto out = n ? pane.take(agg, pane.first, pane.last) : pane.take(agg, start, start + width);
+        _Out result{std::move(it->first), std::move(out)};
+        order.erase(it->second.pos);
+        slots.erase(it);
+        return result;
+    }
+
+public:
+    keyed_tumbling(F key_fn, A agg, std::size_t n, window_clock::duration width, window_clock::duration idle):
+        key_fn(std::move(key_fn)), agg(std::move(agg)), n(n), width(width), idle(idle) {}
+
+    std::optional<window_clock::time_point> deadline() const {
+        if (order.empty()) { return std::nullopt; }
+        if (!n) { return start + width; }
+        if (idle <= window_clock::duration::zero()) { return std::nullopt; }
+        return slots.find(order.front())->second.pane.last + idle;
+    }
+
+    std::optional<_Out> due(window_clock::time_point now) {
+        auto d = deadline();
+        if (!d || now < *d) { return std::nullopt; }
+        return finish();
+    }
+
+    std::optional<_Out> add(auto&& item, window_clock::time_point now) {
+        if (!n && order.empty()) { start = window_floor(now, width); }
+        auto key = K(std::invoke(key_fn, std::as_const(item)));
+        auto [it, added] = slots.try_emplace(key);
+        if (added) { it->second.pos = order.insert(order.end(), std::move(key)); }
+        else if (n) { order.splice(order.end(), order, it->second.pos); }
+        it->second.pane.add(agg, item, now);
+        if (!n || it->second.pane.count < n) { return std::nullopt; }
+        return take(it);
+    }
+
+    std::optional<_Out> finish() {
+        if (order.empty()) { return std::nullopt; }
+        return take(slots.find(order.front()));
+    }
+};
+
+template <typename G>
+using window_item_t = std::remove_cvref_t<stream_item<G>>;
+
+} // namespace _
+
+/**
+ * @brief Aggregates every `n` items of an async generator, and yields a
+ *        `window_result` per window.
+ *
+ * Items are added to the state of `agg` as they arrive, so only the state of
+ * the window being filled is kept. With a positive `idle`, a window left
+ * partial for `idle` after its last item is emitted then, otherwise only when
+ * full or when the source returns. An exception thrown by the source is
+ * rethrown after the windows completed before it.
+ *
+ * Items are pulled by the resulting generator, which is resumed on the thread
+ * of the source, or on the executor it was awaited on (or the timer thread
+ * without one) when flushed by a timer of `default_timer()`. Destroying it
+ * while the source is still suspended on some pending operation is undefined.
+ *
+ * Besides the generator frame, this allocates the state shared with the timer
+ * and a relay frame, and every idle timer allocates a frame and a node of the
+ * timer queue. Nothing is allocated per item.
+ */
+template <typename Y, typename S, typename A>
+auto tumbling_window(crt::async_generator<Y, S>&& gen, std::size_t n, A agg,
+                     timer_queue::clock::duration idle = timer_queue::clock::duration::zero())
+    -> crt::async_generator<window_result<_::aggregate_result_t<A>>>
+{
+    using _Out = window_result<_::aggregate_result_t<A>>;
+    return _::run_windows<_Out>(std::move(gen), _::count_tumbling<A>(std::move(agg), n, idle));
+}
+
+/**
+ * @brief Aggregates items of an async generator arriving in consecutive
+ *        windows of `width`, and yields a `window_result` per window with
+ *        items.
+ *
+ * Windows are aligned to multiples of `width` since the clock epoch, and an
+ * item falls in the window of its arrival time. A window is emitted at its end
+ * even if no item arrives after it. Otherwise this works as the overload
+ * taking a count.
+ */
+template <typename Y, typename S, typename A>
+auto tumbling_window(crt::async_generator<Y, S>&& gen, timer_queue::clock::duration width, A agg)
+    -> crt::async_generator<window_result<_::aggregate_result_t<A>>>
+{
+    using _Out = window_result<_::aggregate_result_t<A>>;
+    if (width <= timer_queue::clock::duration::zero()) { throw std::invalid_argument("width of a window should be positive"); }
+    return _::run_windows<_Out>(std::move(gen), _::time_tumbling<A>(std::move(agg), width));
+}
+
+/**
+ * @brief Aggregates the last `size` items of an async generator every `slide`
+ *        items, and yields a `window_result` per window.
+ *
+ * `size` should be a multiple of `slide`. Items are added to panes of `slide`
+ * items each, and a window merges the states of its `size / slide` panes with
+ * `agg.merge`, so an item is added once and no item is kept. With a positive
+ * `idle`, the window ending at the last item is emitted after `idle` without
+ * another one. When the source returns, the window ending at the last item is
+ * emitted unless it already was. Otherwise this works as `tumbling_window`.
+ *
+ * This allocates the panes once, besides what `tumbling_window` allocates.
+ */
+template <typename Y, typename S, typename A>
+auto sliding_window(crt::async_generator<Y, S>&& gen, std::size_t size, std::size_t slide, A agg,
+                    timer_queue::clock::duration idle = timer_queue::clock::duration::zero())
+    -> crt::async_generator<window_result<_::aggregate_result_t<A>>>
+{
+    using _Out = window_result<_::aggregate_result_t<A>>;
+    return _::run_windows<_Out>(std::move(gen), _::count_sliding<A>(std::move(agg), size, slide, idle));
+}
+
+/**
+ * @brief Aggregates items of an async generator arriving in the last `size`
+ *        every `slide`, and yields a `window_result` per window with items.
+ *
+ * `size` should be a multiple of `slide`, and windows end at multiples of
+ * `slide` since the clock epoch. When the source returns, the window ending
+ * after the last item is emitted. Otherwise this works as the overload taking
+ * counts.
+ */
+template <typename Y, typename S, typename A>
+auto sliding_window(crt::async_generator<Y, S>&& gen, timer_queue::clock::duration size,
+                    timer_queue::clock::duration slide, A agg)
+    -> crt::async_generator<window_result<_::aggregate_result_t<A>>>
+{
+    using _Out = window_result<_::aggregate_result_t<A>>;
+    return _::run_windows<_Out>(std::move(gen), _::time_sliding<A>(std::move(agg), size, slide));
+}
+
+/**
+ * @brief Aggregates every `n` items of an async generator with the same key,
+ *        and yields the key with a `window_result` per window.
+ *
+ * The key of an item is `key_fn(item)`. Every key has a window of its own,
+ * which is emitted when full, after `idle` without another item of the key
+ * when `idle` is positive, or when the source returns, from the least recently
+ * added to. Otherwise this works as `tumbling_window`.
+ *
+ * Adding an item is O(1) on average. The states of keys are allocated when
+ * they get the first item of a window, and freed when it is emitted.
+ */
+template <typename Y, typename S, typename F, typename A>
+auto group_by_key(crt::async_generator<Y, S>&& gen, F key_fn, std::size_t n, A agg,
+                  timer_queue::clock::duration idle = timer_queue::clock::duration::zero())
+{
+    using _Gen = crt::async_generator<Y, S>;
+    using _Key = std::remove_cvref_t<std::invoke_result_t<F&, const _::window_item_t<_Gen>&>>;
+    using _Out = std::pair<_Key, window_result<_::aggregate_result_t<A>>>;
+    return _::run_windows<_Out>(std::move(gen),
+        _::keyed_tumbling<_Key, F, A>(std::move(key_fn), std::move(agg), n ? n : 1, {}, idle));
+}
+
+/**
+ * @brief Aggregates items of an async generator with the same key arriving
+ *        in consecutive windows of `width`, and yields the key with a
+ *        `window_result` per window with items.
+ *
+ * Windows of all keys share the bounds of `tumbling_window`, and at the end of
+ * one, keys are emitted in the order they first got an item in it.
+ */
+template <typename Y, typename S, typename F, typename A>
+auto group_by_key(crt::async_generator<Y, S>&& gen, F key_fn, timer_queue::clock::duration width, A agg)
+{
+    using _Gen = crt::async_generator<Y, S>;
+    using _Key = std::remove_cvref_t<std::invoke_result_t<F&, const _::window_item_t<_Gen>&>>;
+    using _Out = std::pair<_Key, window_result<_::aggregate_result_t<A>>>;
+    if (width <= timer_queue::clock::duration::zero()) { throw std::invalid_argument("width of a window should be positive"); }
+    return _::run_windows<_Out>(std::move(gen),
+        _::keyed_tumbling<_Key, F, A>(std::move(key_fn), std::move(agg), 0, width, {}));
+}
+
+} // namespace coutils
+
+#endif // __COUTILS_WINDOW__